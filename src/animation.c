@@ -0,0 +1,271 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "./include/animation.h"
+#include "./include/png.h"
+
+struct Animation
+{
+	const unsigned char* data;
+	size_t size;
+	struct ImageInfo info;
+	struct PNGFrame* frames;
+	AnimationWake wake;
+	unsigned char *canvas, *saved, *scratch;
+
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t changed;
+	struct AnimationRect dirty;
+	double delay;
+	int ready, locked, failed;
+	atomic_int stop;
+};
+
+static void beginFrameRows(void* user)
+{
+	(void)user;
+}
+
+static int endFrameRows(void* user, const int y, const int count)
+{
+	(void)y;
+	(void)count;
+	const struct Animation* animation = user;
+	return !atomic_load(&animation->stop);
+}
+
+static void copyRegion(unsigned char* dst, const size_t dstStride, const unsigned char* src, const size_t srcStride,
+                       const size_t rowBytes, const int rows)
+{
+	for (int r = 0; r < rows; ++r) memcpy(dst + (size_t)r * dstStride, src + (size_t)r * srcStride, rowBytes);
+}
+
+// Straight-alpha "over", as APNG specifies it for 8-bit samples
+static void blendRow(unsigned char* dst, const unsigned char* src, const int width)
+{
+	for (int x = 0; x < width; ++x, dst += 4, src += 4)
+	{
+		const unsigned int sa = src[3];
+		if (sa == 255)
+		{
+			memcpy(dst, src, 4);
+			continue;
+		}
+		if (sa == 0) continue;
+
+		const unsigned int da = dst[3] * (255 - sa), a = sa * 255 + da;
+		for (int c = 0; c < 3; ++c) dst[c] = (unsigned char)((src[c] * sa * 255 + dst[c] * da + a / 2) / a);
+		dst[3] = (unsigned char)((a + 127) / 255);
+	}
+}
+
+static void unite(struct AnimationRect* r, const struct PNGFrame* f)
+{
+	const int x1 = r->x + r->width > f->x + f->width ? r->x + r->width : f->x + f->width;
+	const int y1 = r->y + r->height > f->y + f->height ? r->y + r->height : f->y + f->height;
+	if (f->x < r->x) r->x = f->x;
+	if (f->y < r->y) r->y = f->y;
+	r->width = x1 - r->x;
+	r->height = y1 - r->y;
+}
+
+// Applies the previous frame's dispose op and composites the decoded frame, touching only the two frame regions.
+// Returns the rectangle of the canvas that changed.
+static struct AnimationRect compositeFrame(struct Animation* animation, const struct PNGFrame* prev,
+                                           const struct PNGFrame* frame)
+{
+	unsigned char* canvas = animation->canvas;
+	const size_t stride = animation->info.stride;
+	struct AnimationRect dirty = {frame->x, frame->y, frame->width, frame->height};
+
+	// Every play starts from a transparent canvas, and the first frame covers all of it
+	if (!prev) memset(canvas, 0, animation->info.size);
+	else if (prev->dispose != PNG_DISPOSE_NONE)
+	{
+		unsigned char* region = canvas + (size_t)prev->y * stride + (size_t)prev->x * 4;
+		const size_t rowBytes = (size_t)prev->width * 4;
+		if (prev->dispose == PNG_DISPOSE_PREVIOUS)
+			copyRegion(region, stride, animation->saved, rowBytes, rowBytes, prev->height);
+		else
+			for (int r = 0; r < prev->height; ++r) memset(region + (size_t)r * stride, 0, rowBytes);
+		unite(&dirty, prev);
+	}
+
+	unsigned char* region = canvas + (size_t)frame->y * stride + (size_t)frame->x * 4;
+	const size_t rowBytes = (size_t)frame->width * 4;
+	if (frame->dispose == PNG_DISPOSE_PREVIOUS) copyRegion(animation->saved, rowBytes, region, stride, rowBytes,
+	                                                      frame->height);
+
+	if (frame->blend == PNG_BLEND_SOURCE || !prev)
+		copyRegion(region, stride, animation->scratch, rowBytes, rowBytes, frame->height);
+	else
+		for (int r = 0; r < frame->height; ++r)
+			blendRow(region + (size_t)r * stride, animation->scratch + (size_t)r * rowBytes, frame->width);
+
+	return dirty;
+}
+
+static void* playAnimation(void* arg)
+{
+	struct Animation* animation = arg;
+	const struct RowSink sink = {beginFrameRows, endFrameRows, animation};
+	const int frames = animation->info.frameCount, loops = animation->info.loopCount;
+
+	for (int play = 0; !loops || play < loops; ++play)
+	{
+		const struct PNGFrame* prev = NULL;
+		for (int i = 0; i < frames; ++i)
+		{
+			// The next frame decodes into scratch memory while the current one is still on screen
+			const struct PNGFrame* frame = &animation->frames[i];
+			const int decoded = decodePNGFrame(animation->data, animation->size, &animation->info, frame,
+			                                   animation->scratch, (size_t)frame->width * 4, &sink);
+
+			pthread_mutex_lock(&animation->lock);
+			while (decoded && (animation->ready || animation->locked) && !atomic_load(&animation->stop))
+				pthread_cond_wait(&animation->changed, &animation->lock);
+			if (atomic_load(&animation->stop) || !decoded)
+			{
+				animation->failed = !decoded && !atomic_load(&animation->stop);
+				pthread_mutex_unlock(&animation->lock);
+				if (animation->failed && animation->wake) animation->wake();
+
+				return NULL;
+			}
+			pthread_mutex_unlock(&animation->lock);
+
+			const struct AnimationRect dirty = compositeFrame(animation, prev, frame);
+			prev = frame;
+
+			pthread_mutex_lock(&animation->lock);
+			animation->dirty = dirty;
+			animation->delay = frame->delay;
+			animation->ready = 1;
+			pthread_mutex_unlock(&animation->lock);
+			if (animation->wake) animation->wake();
+		}
+
+		// A single frame never changes, so there is nothing to loop
+		if (frames == 1) break;
+	}
+
+	return NULL;
+}
+
+struct Animation* openAnimation(const unsigned char* data, const size_t size, const struct ImageInfo* info,
+                                const AnimationWake wake)
+{
+	if (!data || !info || !isAnimatedImage(info)) return NULL;
+
+	struct Animation* animation = calloc(1, sizeof(*animation));
+	if (!animation)
+	{
+		fprintf(stderr, "Failed to allocate memory for animation\n");
+		return NULL;
+	}
+
+	animation->data = data;
+	animation->size = size;
+	animation->info = *info;
+	animation->wake = wake;
+	atomic_init(&animation->stop, 0);
+
+	animation->frames = malloc((size_t)info->frameCount * sizeof(*animation->frames));
+	if (!animation->frames || !readPNGFrames(data, size, info, animation->frames) ||
+		!setImageFormat(&animation->info, PIXEL_FORMAT_RGBA8))
+	{
+		free(animation->frames);
+		free(animation);
+		return NULL;
+	}
+
+	int keepsPrevious = 0;
+	for (int i = 0; i < info->frameCount; ++i) keepsPrevious |= animation->frames[i].dispose == PNG_DISPOSE_PREVIOUS;
+
+	// Frames never exceed the canvas, so one canvas-sized buffer holds any frame or any saved region
+	animation->canvas = malloc(animation->info.size);
+	animation->scratch = malloc(animation->info.size);
+	animation->saved = keepsPrevious ? malloc(animation->info.size) : NULL;
+	if (!animation->canvas || !animation->scratch || (keepsPrevious && !animation->saved))
+	{
+		fprintf(stderr, "Failed to allocate memory for animation\n");
+		free(animation->saved);
+		free(animation->scratch);
+		free(animation->canvas);
+		free(animation->frames);
+		free(animation);
+
+		return NULL;
+	}
+
+	pthread_mutex_init(&animation->lock, NULL);
+	pthread_cond_init(&animation->changed, NULL);
+	if (pthread_create(&animation->thread, NULL, playAnimation, animation) != 0)
+	{
+		fprintf(stderr, "Failed to start animation thread\n");
+		pthread_cond_destroy(&animation->changed);
+		pthread_mutex_destroy(&animation->lock);
+		free(animation->saved);
+		free(animation->scratch);
+		free(animation->canvas);
+		free(animation->frames);
+		free(animation);
+
+		return NULL;
+	}
+
+	return animation;
+}
+
+void closeAnimation(struct Animation* animation)
+{
+	if (!animation) return;
+
+	pthread_mutex_lock(&animation->lock);
+	atomic_store(&animation->stop, 1);
+	pthread_cond_broadcast(&animation->changed);
+	pthread_mutex_unlock(&animation->lock);
+	pthread_join(animation->thread, NULL);
+
+	pthread_cond_destroy(&animation->changed);
+	pthread_mutex_destroy(&animation->lock);
+	free(animation->saved);
+	free(animation->scratch);
+	free(animation->canvas);
+	free(animation->frames);
+	free(animation);
+}
+
+const struct ImageInfo* getAnimationInfo(const struct Animation* animation)
+{
+	return &animation->info;
+}
+
+int lockAnimationFrame(struct Animation* animation, const void** canvas, struct AnimationRect* dirty, double* delay)
+{
+	pthread_mutex_lock(&animation->lock);
+	const int state = animation->failed ? -1 : animation->ready;
+	if (state > 0)
+	{
+		animation->ready = 0;
+		animation->locked = 1;
+		*canvas = animation->canvas;
+		*dirty = animation->dirty;
+		*delay = animation->delay;
+	}
+	pthread_mutex_unlock(&animation->lock);
+
+	return state;
+}
+
+void unlockAnimationFrame(struct Animation* animation)
+{
+	pthread_mutex_lock(&animation->lock);
+	animation->locked = 0;
+	pthread_cond_broadcast(&animation->changed);
+	pthread_mutex_unlock(&animation->lock);
+}
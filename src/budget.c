@@ -0,0 +1,56 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "./include/budget.h"
+
+static size_t decodeMemory = DEFAULT_DECODE_MEMORY, decodeDisk = DEFAULT_DECODE_DISK;
+static const char* spillDirectory;
+
+void setDecodeBudget(const size_t memory, const size_t disk, const char* spillDir)
+{
+	decodeMemory = memory;
+	decodeDisk = disk;
+	spillDirectory = spillDir;
+}
+
+int planDecode(struct ImageInfo* info, const size_t extra)
+{
+	size_t needed = info->size > SIZE_MAX - info->scratchSize ? SIZE_MAX : info->size + info->scratchSize;
+	needed = needed > SIZE_MAX - extra ? SIZE_MAX : needed + extra;
+	info->outOfCore = needed > decodeMemory;
+	if (!info->outOfCore || needed <= decodeDisk) return 1;
+
+	fprintf(stderr, "Image too large: %dx%d needs %zu MB, over the %zu MB memory and %zu MB disk budgets\n",
+	        info->width, info->height, needed >> 20, decodeMemory >> 20, decodeDisk >> 20);
+	return 0;
+}
+
+void* allocDecodeBuffer(const size_t size, const int outOfCore, struct DecodeBuffer* out)
+{
+	memset(out, 0, sizeof(*out));
+	if (!outOfCore)
+	{
+		out->data = calloc(1, size ? size : 1);
+		return out->data;
+	}
+
+	if (!createTempMappedFile(spillDirectory, size ? size : 1, &out->file))
+	{
+		fprintf(stderr, "Failed to create a %zu MB out-of-core buffer in %s\n", size >> 20,
+		        spillDirectory ? spillDirectory : "the temp directory");
+		return NULL;
+	}
+
+	out->data = out->file.data;
+	return out->data;
+}
+
+void freeDecodeBuffer(struct DecodeBuffer* buffer)
+{
+	if (buffer->file.data) unmapFile(&buffer->file);
+	else free(buffer->data);
+
+	buffer->data = NULL;
+}
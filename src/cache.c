@@ -0,0 +1,447 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "./include/cache.h"
+
+#define CACHE_SHARDS 16
+#define CACHE_MIN_BUCKETS 16
+#define CACHE_EVICTION_CANDIDATES 8
+
+#define HASH_P1 0x9E3779B185EBCA87ull
+#define HASH_P2 0xC2B2AE3D27D4EB4Full
+#define HASH_P3 0x165667B19E3779F9ull
+#define HASH_P4 0x85EBCA77C2B2AE63ull
+#define HASH_P5 0x27D4EB2F165667C5ull
+
+struct CacheEntry
+{
+	struct CachedImage image;
+	uint64_t hash;
+	enum PixelFormat format; // as requested, so PIXEL_FORMAT_NATIVE lookups match too
+	size_t encodedSize, bytes;
+	double costPerByte;
+	unsigned int refs, shard;
+	int cached;
+	struct CacheEntry *chain, *newer, *older;
+};
+
+struct CacheShard
+{
+	pthread_mutex_t lock;
+	struct CacheEntry** buckets;
+	size_t bucketCount, entries;
+	struct CacheEntry *newest, *oldest;
+};
+
+struct ImageCache
+{
+	struct CacheShard shards[CACHE_SHARDS];
+	size_t budget;
+	atomic_size_t bytes, entries, hits, misses, evictions;
+};
+
+static uint64_t rotl64(const uint64_t v, const int r)
+{
+	return v << r | v >> (64 - r);
+}
+
+static uint64_t read64(const unsigned char* p)
+{
+	uint64_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static uint32_t read32(const unsigned char* p)
+{
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static uint64_t hashRound(uint64_t acc, const uint64_t input)
+{
+	acc += input * HASH_P2;
+	acc = rotl64(acc, 31);
+	return acc * HASH_P1;
+}
+
+static uint64_t hashMerge(uint64_t acc, const uint64_t lane)
+{
+	acc ^= hashRound(0, lane);
+	return acc * HASH_P1 + HASH_P4;
+}
+
+// XXH64: four independent multiply-rotate lanes over 32-byte stripes, so the loop runs at memory bandwidth.
+uint64_t hashBytes(const void* data, const size_t size, const uint64_t seed)
+{
+	const unsigned char *p = data, *end = p + size;
+	uint64_t h;
+
+	if (size >= 32)
+	{
+		uint64_t v1 = seed + HASH_P1 + HASH_P2, v2 = seed + HASH_P2, v3 = seed, v4 = seed - HASH_P1;
+		do
+		{
+			v1 = hashRound(v1, read64(p));
+			v2 = hashRound(v2, read64(p + 8));
+			v3 = hashRound(v3, read64(p + 16));
+			v4 = hashRound(v4, read64(p + 24));
+			p += 32;
+		}
+		while ((size_t)(end - p) >= 32);
+
+		h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+		h = hashMerge(h, v1);
+		h = hashMerge(h, v2);
+		h = hashMerge(h, v3);
+		h = hashMerge(h, v4);
+	}
+	else h = seed + HASH_P5;
+
+	h += (uint64_t)size;
+	for (; (size_t)(end - p) >= 8; p += 8)
+	{
+		h ^= hashRound(0, read64(p));
+		h = rotl64(h, 27) * HASH_P1 + HASH_P4;
+	}
+	if ((size_t)(end - p) >= 4)
+	{
+		h ^= (uint64_t)read32(p) * HASH_P1;
+		h = rotl64(h, 23) * HASH_P2 + HASH_P3;
+		p += 4;
+	}
+	for (; p < end; ++p)
+	{
+		h ^= (uint64_t)*p * HASH_P5;
+		h = rotl64(h, 11) * HASH_P1;
+	}
+
+	h ^= h >> 33;
+	h *= HASH_P2;
+	h ^= h >> 29;
+	h *= HASH_P3;
+	h ^= h >> 32;
+
+	return h;
+}
+
+static double nowSeconds(void)
+{
+	struct timespec ts;
+	timespec_get(&ts, TIME_UTC);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void freeEntry(struct CacheEntry* e)
+{
+	if (!e) return;
+	free(e->image.pixels);
+	free(e);
+}
+
+static void unlinkRecent(struct CacheShard* shard, struct CacheEntry* e)
+{
+	if (e->newer) e->newer->older = e->older;
+	else shard->newest = e->older;
+	if (e->older) e->older->newer = e->newer;
+	else shard->oldest = e->newer;
+
+	e->newer = e->older = NULL;
+}
+
+static void linkNewest(struct CacheShard* shard, struct CacheEntry* e)
+{
+	e->newer = NULL;
+	e->older = shard->newest;
+	if (shard->newest) shard->newest->newer = e;
+	shard->newest = e;
+	if (!shard->oldest) shard->oldest = e;
+}
+
+static struct CacheEntry* findEntry(const struct CacheShard* shard, const uint64_t hash, const size_t encodedSize,
+                                    const enum PixelFormat format)
+{
+	for (struct CacheEntry* e = shard->buckets[hash & (shard->bucketCount - 1)]; e; e = e->chain)
+		if (e->hash == hash && e->encodedSize == encodedSize && e->format == format) return e;
+
+	return NULL;
+}
+
+static int growBuckets(struct CacheShard* shard)
+{
+	const size_t newCount = shard->bucketCount * 2;
+	struct CacheEntry** buckets = calloc(newCount, sizeof(*buckets));
+	if (!buckets) return 0;
+
+	for (size_t i = 0; i < shard->bucketCount; ++i)
+		for (struct CacheEntry* e = shard->buckets[i]; e;)
+		{
+			struct CacheEntry* next = e->chain;
+			e->chain = buckets[e->hash & (newCount - 1)];
+			buckets[e->hash & (newCount - 1)] = e;
+			e = next;
+		}
+
+	free(shard->buckets);
+	shard->buckets = buckets;
+	shard->bucketCount = newCount;
+
+	return 1;
+}
+
+static void insertEntry(struct CacheShard* shard, struct CacheEntry* e)
+{
+	if (shard->entries >= shard->bucketCount) growBuckets(shard);
+
+	struct CacheEntry** bucket = &shard->buckets[e->hash & (shard->bucketCount - 1)];
+	e->chain = *bucket;
+	*bucket = e;
+	e->cached = 1;
+
+	linkNewest(shard, e);
+	shard->entries++;
+}
+
+static void removeEntry(struct CacheShard* shard, struct CacheEntry* e)
+{
+	for (struct CacheEntry** link = &shard->buckets[e->hash & (shard->bucketCount - 1)]; *link; link = &(*link)->chain)
+		if (*link == e)
+		{
+			*link = e->chain;
+			break;
+		}
+
+	unlinkRecent(shard, e);
+	e->chain = NULL;
+	e->cached = 0;
+	shard->entries--;
+}
+
+// Looks at the few least recently used idle entries and drops the one that was cheapest to decode per byte it
+// holds, so a large but trivially decoded PPM goes before a small but expensive PNG of the same age.
+static size_t evictFromShard(struct ImageCache* cache, struct CacheShard* shard)
+{
+	struct CacheEntry* victim = NULL;
+
+	pthread_mutex_lock(&shard->lock);
+	int seen = 0;
+	for (struct CacheEntry* e = shard->oldest; e && seen < CACHE_EVICTION_CANDIDATES; e = e->newer)
+	{
+		if (e->refs) continue;
+		if (!victim || e->costPerByte < victim->costPerByte) victim = e;
+		seen++;
+	}
+	if (victim) removeEntry(shard, victim);
+	pthread_mutex_unlock(&shard->lock);
+
+	if (!victim) return 0;
+
+	const size_t freed = victim->bytes;
+	atomic_fetch_sub(&cache->bytes, freed);
+	atomic_fetch_sub(&cache->entries, 1);
+	atomic_fetch_add(&cache->evictions, 1);
+	freeEntry(victim);
+
+	return freed;
+}
+
+static void enforceBudget(struct ImageCache* cache, const unsigned int home)
+{
+	unsigned int idle = 0;
+	for (unsigned int i = home; atomic_load(&cache->bytes) > cache->budget && idle < CACHE_SHARDS; ++i)
+	{
+		if (evictFromShard(cache, &cache->shards[i % CACHE_SHARDS])) idle = 0;
+		else idle++;
+	}
+}
+
+static struct CacheEntry* decodeEntry(const unsigned char* data, const size_t size, const enum PixelFormat format,
+                                      const struct RowSink* sink)
+{
+	struct CacheEntry* e = calloc(1, sizeof(*e));
+	if (!e) return NULL;
+
+	const double start = nowSeconds();
+	if (!getImageInfo(data, size, format, &e->image.info))
+	{
+		free(e);
+		return NULL;
+	}
+	if (e->image.info.outOfCore)
+	{
+		fprintf(stderr, "Image over the decode memory budget cannot be cached: %zu bytes\n", e->image.info.size);
+		free(e);
+
+		return NULL;
+	}
+
+	e->image.pixels = malloc(e->image.info.size);
+	if (!e->image.pixels)
+	{
+		fprintf(stderr, "Failed to allocate %zu bytes for cached image\n", e->image.info.size);
+		free(e);
+
+		return NULL;
+	}
+
+	if (!parseImageProgressive(data, size, &e->image.info, e->image.pixels, e->image.info.stride, sink))
+	{
+		freeEntry(e);
+		return NULL;
+	}
+
+	e->format = format;
+	e->encodedSize = size;
+	e->bytes = sizeof(*e) + e->image.info.size;
+	e->costPerByte = (nowSeconds() - start) / (double)e->bytes;
+
+	return e;
+}
+
+struct ImageCache* createImageCache(const size_t budget)
+{
+	struct ImageCache* cache = calloc(1, sizeof(*cache));
+	if (!cache) return NULL;
+
+	cache->budget = budget;
+	for (int i = 0; i < CACHE_SHARDS; ++i)
+	{
+		struct CacheShard* shard = &cache->shards[i];
+		shard->bucketCount = CACHE_MIN_BUCKETS;
+		shard->buckets = calloc(shard->bucketCount, sizeof(*shard->buckets));
+
+		if (!shard->buckets || pthread_mutex_init(&shard->lock, NULL) != 0)
+		{
+			free(shard->buckets);
+			for (int j = 0; j < i; ++j)
+			{
+				pthread_mutex_destroy(&cache->shards[j].lock);
+				free(cache->shards[j].buckets);
+			}
+			free(cache);
+
+			return NULL;
+		}
+	}
+
+	return cache;
+}
+
+void destroyImageCache(struct ImageCache* cache)
+{
+	if (!cache) return;
+
+	for (int i = 0; i < CACHE_SHARDS; ++i)
+	{
+		struct CacheShard* shard = &cache->shards[i];
+		for (struct CacheEntry* e = shard->oldest; e;)
+		{
+			struct CacheEntry* next = e->newer;
+			freeEntry(e);
+			e = next;
+		}
+
+		pthread_mutex_destroy(&shard->lock);
+		free(shard->buckets);
+	}
+
+	free(cache);
+}
+
+const struct CachedImage* acquireImage(struct ImageCache* cache, const unsigned char* data, const size_t size,
+                                       const enum PixelFormat format, const struct RowSink* sink)
+{
+	if (!cache || !data || !size) return NULL;
+
+	const uint64_t hash = hashBytes(data, size, (uint64_t)format);
+	const unsigned int index = (unsigned int)(hash >> 60) % CACHE_SHARDS;
+	struct CacheShard* shard = &cache->shards[index];
+
+	pthread_mutex_lock(&shard->lock);
+	struct CacheEntry* e = findEntry(shard, hash, size, format);
+	if (e)
+	{
+		e->refs++;
+		unlinkRecent(shard, e);
+		linkNewest(shard, e);
+		pthread_mutex_unlock(&shard->lock);
+
+		atomic_fetch_add(&cache->hits, 1);
+		return &e->image;
+	}
+	pthread_mutex_unlock(&shard->lock);
+
+	atomic_fetch_add(&cache->misses, 1);
+	struct CacheEntry* decoded = decodeEntry(data, size, format, sink);
+	if (!decoded) return NULL;
+
+	decoded->hash = hash;
+	decoded->shard = index;
+	decoded->refs = 1;
+
+	if (decoded->bytes > cache->budget) return &decoded->image;
+
+	pthread_mutex_lock(&shard->lock);
+	e = findEntry(shard, hash, size, format);
+	if (e)
+	{
+		e->refs++;
+		pthread_mutex_unlock(&shard->lock);
+		freeEntry(decoded);
+
+		return &e->image;
+	}
+	insertEntry(shard, decoded);
+	pthread_mutex_unlock(&shard->lock);
+
+	atomic_fetch_add(&cache->bytes, decoded->bytes);
+	atomic_fetch_add(&cache->entries, 1);
+	enforceBudget(cache, index);
+
+	if (atomic_load(&cache->bytes) > cache->budget)
+	{
+		pthread_mutex_lock(&shard->lock);
+		const int dropped = decoded->cached;
+		if (dropped) removeEntry(shard, decoded);
+		pthread_mutex_unlock(&shard->lock);
+
+		if (dropped)
+		{
+			atomic_fetch_sub(&cache->bytes, decoded->bytes);
+			atomic_fetch_sub(&cache->entries, 1);
+		}
+	}
+
+	return &decoded->image;
+}
+
+void releaseImage(struct ImageCache* cache, const struct CachedImage* image)
+{
+	if (!cache || !image) return;
+
+	struct CacheEntry* e = (struct CacheEntry*)image;
+	struct CacheShard* shard = &cache->shards[e->shard];
+
+	pthread_mutex_lock(&shard->lock);
+	const int dead = --e->refs == 0 && !e->cached;
+	pthread_mutex_unlock(&shard->lock);
+
+	if (dead) freeEntry(e);
+}
+
+void getImageCacheStats(struct ImageCache* cache, struct ImageCacheStats* out)
+{
+	if (!cache || !out) return;
+
+	out->hits = atomic_load(&cache->hits);
+	out->misses = atomic_load(&cache->misses);
+	out->evictions = atomic_load(&cache->evictions);
+	out->entries = atomic_load(&cache->entries);
+	out->bytes = atomic_load(&cache->bytes);
+	out->budget = cache->budget;
+}
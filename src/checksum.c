@@ -0,0 +1,216 @@
+#include <pthread.h>
+#include <stdint.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CHECKSUM_SSE2 1
+#endif
+
+// Carry-less multiply is picked at run time, so it is compiled in on x86-64 regardless of the target flags
+#if (defined(__GNUC__) && defined(__x86_64__)) || defined(_M_X64)
+#include <wmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define CHECKSUM_CLMUL_TARGET
+#else
+#include <cpuid.h>
+#define CHECKSUM_CLMUL_TARGET __attribute__((target("pclmul")))
+#endif
+#define CHECKSUM_CLMUL 1
+#endif
+
+#include "./include/checksum.h"
+
+#define ADLER_BASE 65521u
+// The most bytes the Adler-32 sums can take before they have to be reduced to stay within 32 bits
+#define ADLER_NMAX 5552
+
+static uint32_t crcTable[16][256];
+static int hasCLMUL;
+static pthread_once_t crcInitOnce = PTHREAD_ONCE_INIT;
+
+static void initCRC(void)
+{
+	for (uint32_t i = 0; i < 256; ++i)
+	{
+		uint32_t c = i;
+		for (int k = 0; k < 8; ++k) c = c & 1 ? 0xEDB88320u ^ c >> 1 : c >> 1;
+		crcTable[0][i] = c;
+	}
+	for (int t = 1; t < 16; ++t)
+		for (int i = 0; i < 256; ++i) crcTable[t][i] = crcTable[t - 1][i] >> 8 ^ crcTable[0][crcTable[t - 1][i] & 0xFF];
+
+#ifdef CHECKSUM_CLMUL
+#ifdef _MSC_VER
+	int regs[4];
+	__cpuid(regs, 1);
+	hasCLMUL = (regs[2] >> 1) & 1;
+#else
+	unsigned int eax, ebx, ecx, edx;
+	hasCLMUL = __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx >> 1 & 1);
+#endif
+#endif
+}
+
+static uint32_t loadLE32(const unsigned char* p)
+{
+	return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// Slice-by-16: sixteen independent table lookups retire sixteen bytes per step
+static uint32_t crcSlice16(uint32_t c, const unsigned char* data, size_t size)
+{
+	for (; size >= 16; data += 16, size -= 16)
+	{
+		const uint32_t w0 = c ^ loadLE32(data), w1 = loadLE32(data + 4), w2 = loadLE32(data + 8),
+		               w3 = loadLE32(data + 12);
+		c = crcTable[15][w0 & 0xFF] ^ crcTable[14][w0 >> 8 & 0xFF] ^ crcTable[13][w0 >> 16 & 0xFF] ^
+			crcTable[12][w0 >> 24] ^ crcTable[11][w1 & 0xFF] ^ crcTable[10][w1 >> 8 & 0xFF] ^
+			crcTable[9][w1 >> 16 & 0xFF] ^ crcTable[8][w1 >> 24] ^ crcTable[7][w2 & 0xFF] ^
+			crcTable[6][w2 >> 8 & 0xFF] ^ crcTable[5][w2 >> 16 & 0xFF] ^ crcTable[4][w2 >> 24] ^
+			crcTable[3][w3 & 0xFF] ^ crcTable[2][w3 >> 8 & 0xFF] ^ crcTable[1][w3 >> 16 & 0xFF] ^
+			crcTable[0][w3 >> 24];
+	}
+	while (size--) c = crcTable[0][(c ^ *data++) & 0xFF] ^ c >> 8;
+
+	return c;
+}
+
+#ifdef CHECKSUM_CLMUL
+// Folds four 128-bit lanes of the message at a time with carry-less multiplies by x^n mod P, then folds those down to
+// one lane and Barrett-reduces it to 32 bits (Gopal et al., "Fast CRC Computation Using PCLMULQDQ"). The constants
+// are for the bit-reflected CRC-32 polynomial. `size` is a multiple of 16 and at least 64.
+CHECKSUM_CLMUL_TARGET static uint32_t crcFold(const uint32_t c, const unsigned char* data, size_t size)
+{
+	const __m128i k1k2 = _mm_set_epi64x(0x01C6E41596, 0x0154442BD4), k3k4 = _mm_set_epi64x(0x00CCAA009E, 0x01751997D0);
+	const __m128i k5 = _mm_set_epi64x(0, 0x0163CD6124), poly = _mm_set_epi64x(0x01F7011641, 0x01DB710641);
+	const __m128i low32 = _mm_setr_epi32(-1, 0, -1, 0);
+
+	__m128i x1 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)data), _mm_cvtsi32_si128((int)c));
+	__m128i x2 = _mm_loadu_si128((const __m128i*)(data + 16)), x3 = _mm_loadu_si128((const __m128i*)(data + 32));
+	__m128i x4 = _mm_loadu_si128((const __m128i*)(data + 48));
+	for (data += 64, size -= 64; size >= 64; data += 64, size -= 64)
+	{
+		x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k1k2, 0x11), _mm_clmulepi64_si128(x1, k1k2, 0x00)),
+		                   _mm_loadu_si128((const __m128i*)data));
+		x2 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x2, k1k2, 0x11), _mm_clmulepi64_si128(x2, k1k2, 0x00)),
+		                   _mm_loadu_si128((const __m128i*)(data + 16)));
+		x3 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x3, k1k2, 0x11), _mm_clmulepi64_si128(x3, k1k2, 0x00)),
+		                   _mm_loadu_si128((const __m128i*)(data + 32)));
+		x4 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x4, k1k2, 0x11), _mm_clmulepi64_si128(x4, k1k2, 0x00)),
+		                   _mm_loadu_si128((const __m128i*)(data + 48)));
+	}
+
+	x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), _mm_clmulepi64_si128(x1, k3k4, 0x00)), x2);
+	x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), _mm_clmulepi64_si128(x1, k3k4, 0x00)), x3);
+	x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), _mm_clmulepi64_si128(x1, k3k4, 0x00)), x4);
+	for (; size >= 16; data += 16, size -= 16)
+		x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), _mm_clmulepi64_si128(x1, k3k4, 0x00)),
+		                   _mm_loadu_si128((const __m128i*)data));
+
+	// 128 bits to 64, then Barrett reduction to the 32-bit remainder
+	x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), _mm_clmulepi64_si128(x1, k3k4, 0x10));
+	x1 = _mm_xor_si128(_mm_clmulepi64_si128(_mm_and_si128(x1, low32), k5, 0x00), _mm_srli_si128(x1, 4));
+	__m128i x2r = _mm_clmulepi64_si128(_mm_and_si128(x1, low32), poly, 0x10);
+	x2r = _mm_clmulepi64_si128(_mm_and_si128(x2r, low32), poly, 0x00);
+	x1 = _mm_xor_si128(x1, x2r);
+
+	return (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(x1, 4));
+}
+#endif
+
+unsigned int updateCRC32(const unsigned int crc, const unsigned char* data, const size_t size)
+{
+	pthread_once(&crcInitOnce, initCRC);
+
+	uint32_t c = ~(uint32_t)crc;
+	size_t done = 0;
+#ifdef CHECKSUM_CLMUL
+	if (hasCLMUL && size >= 64)
+	{
+		done = size & ~(size_t)15;
+		c = crcFold(c, data, done);
+	}
+#endif
+
+	return ~crcSlice16(c, data + done, size - done);
+}
+
+// Sixteen bytes per step: psadbw sums them for `a`, and pmaddwd weights them 16..1 for their share of `b`. Each earlier
+// step's sum counts sixteen more times towards `b`, which `prefix` collects.
+static uint32_t adlerBlocks(uint32_t adler, const unsigned char* data, const size_t blocks)
+{
+	uint64_t a = adler & 0xFFFF, b = adler >> 16;
+#ifdef CHECKSUM_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i weightsHi = _mm_setr_epi16(16, 15, 14, 13, 12, 11, 10, 9), weightsLo = _mm_setr_epi16(8, 7, 6, 5, 4, 3,
+		                                                                                                   2, 1);
+	__m128i sum = zero, weighted = zero, prefix = zero;
+	for (size_t i = 0; i < blocks; ++i, data += 16)
+	{
+		const __m128i v = _mm_loadu_si128((const __m128i*)data);
+		prefix = _mm_add_epi32(prefix, sum);
+		sum = _mm_add_epi32(sum, _mm_sad_epu8(v, zero));
+		weighted = _mm_add_epi32(weighted, _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi8(v, zero), weightsHi),
+		                                                 _mm_madd_epi16(_mm_unpackhi_epi8(v, zero), weightsLo)));
+	}
+
+	uint32_t lanes[3][4];
+	_mm_storeu_si128((__m128i*)lanes[0], sum);
+	_mm_storeu_si128((__m128i*)lanes[1], weighted);
+	_mm_storeu_si128((__m128i*)lanes[2], prefix);
+	const uint64_t sumAll = (uint64_t)lanes[0][0] + lanes[0][1] + lanes[0][2] + lanes[0][3];
+	const uint64_t weightedAll = (uint64_t)lanes[1][0] + lanes[1][1] + lanes[1][2] + lanes[1][3];
+	const uint64_t prefixAll = (uint64_t)lanes[2][0] + lanes[2][1] + lanes[2][2] + lanes[2][3];
+
+	b += a * 16 * blocks + prefixAll * 16 + weightedAll;
+	a += sumAll;
+#else
+	for (size_t i = 0; i < blocks * 16; ++i)
+	{
+		a += data[i];
+		b += a;
+	}
+#endif
+
+	return (uint32_t)(b % ADLER_BASE) << 16 | (uint32_t)(a % ADLER_BASE);
+}
+
+unsigned int updateAdler32(const unsigned int adler, const unsigned char* data, size_t size)
+{
+	uint32_t value = adler;
+	while (size)
+	{
+		const size_t n = size < ADLER_NMAX ? size : ADLER_NMAX, blocks = n / 16;
+		value = adlerBlocks(value, data, blocks);
+
+		uint32_t a = value & 0xFFFF, b = value >> 16;
+		for (size_t i = blocks * 16; i < n; ++i)
+		{
+			a += data[i];
+			b += a;
+		}
+
+		value = (b % ADLER_BASE) << 16 | (a % ADLER_BASE);
+		data += n;
+		size -= n;
+	}
+
+	return value;
+}
+
+unsigned int combineAdler32(const unsigned int first, const unsigned int second, const size_t secondSize)
+{
+	const uint32_t rem = (uint32_t)(secondSize % ADLER_BASE);
+	uint32_t a = first & 0xFFFF;
+	uint32_t b = (uint32_t)((uint64_t)rem * a % ADLER_BASE);
+	a += (second & 0xFFFF) + ADLER_BASE - 1;
+	b += (first >> 16) + (second >> 16) + ADLER_BASE - rem;
+
+	if (a >= ADLER_BASE) a -= ADLER_BASE;
+	if (a >= ADLER_BASE) a -= ADLER_BASE;
+	if (b >= ADLER_BASE << 1) b -= ADLER_BASE << 1;
+	if (b >= ADLER_BASE) b -= ADLER_BASE;
+
+	return b << 16 | a;
+}
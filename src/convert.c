@@ -0,0 +1,475 @@
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "./include/renderer.h"
+#include "./include/convert.h"
+
+// Every (layout, output format, transfer) combination is stamped out below as its own straight-line loop, so the
+// per-image choices (bit depth, channel count, maxVal scaling) are made once in initRowConversion and never inside
+// a pixel loop. DIRECT is used when maxVal is the natural maximum of the layout's bit depth, LUT otherwise. Palette
+// layouts always expand through the 8-bit RGBA palette in the context, or copy the raw indices for INDEX8 output.
+// 16-bit output formats are stored in host byte order, ready for a GL_UNSIGNED_SHORT upload. A color transfer (PNG
+// gAMA) rides on the same LUT variant, so gamma-correct output costs one table lookup per sample; alpha always goes
+// through its own linear table.
+
+#define ROW_LAYOUTS(X) \
+	X(PBM1, 1, GRAY_FORMATS) \
+	X(GRAY1, 1, GRAY_FORMATS) \
+	X(GRAY2, 2, GRAY_FORMATS) \
+	X(GRAY4, 4, GRAY_FORMATS) \
+	X(GRAY8, 8, GRAY_FORMATS) \
+	X(GRAY16, 16, GRAY_FORMATS) \
+	X(GRAYA8, 8, COLOR_FORMATS) \
+	X(GRAYA16, 16, COLOR_FORMATS) \
+	X(RGB8, 8, COLOR_FORMATS) \
+	X(RGB16, 16, COLOR_FORMATS) \
+	X(RGBA8, 8, COLOR_FORMATS) \
+	X(RGBA16, 16, COLOR_FORMATS) \
+	X(INDEX1, 8, INDEX_FORMATS) \
+	X(INDEX2, 8, INDEX_FORMATS) \
+	X(INDEX4, 8, INDEX_FORMATS) \
+	X(INDEX8, 8, INDEX_FORMATS)
+
+#define COLOR_FORMATS(X, layout, depth) \
+	X(layout, depth, POINT) \
+	X(layout, depth, RGB8) \
+	X(layout, depth, RGBA8) \
+	X(layout, depth, RGBA32F) \
+	X(layout, depth, RGB16) \
+	X(layout, depth, RGBA16)
+
+#define GRAY_FORMATS(X, layout, depth) \
+	COLOR_FORMATS(X, layout, depth) \
+	X(layout, depth, GRAY8) \
+	X(layout, depth, GRAY16)
+
+#define INDEX_FORMATS(X, layout, depth) \
+	COLOR_FORMATS(X, layout, depth) \
+	X(layout, depth, INDEX8)
+
+#define INDEX_INDEX1(s, x) ((unsigned int)(s)[(x) >> 3] >> (7 - ((x) & 7)) & 1u)
+#define INDEX_INDEX2(s, x) ((unsigned int)(s)[(x) >> 2] >> (6 - 2 * ((x) & 3)) & 3u)
+#define INDEX_INDEX4(s, x) ((unsigned int)(s)[(x) >> 1] >> (4 - 4 * ((x) & 1)) & 15u)
+#define INDEX_INDEX8(s, x) ((unsigned int)(s)[x])
+
+#define BE16(s, i) ((unsigned int)(s)[2 * (i)] << 8 | (unsigned int)(s)[2 * (i) + 1])
+
+// Channel 3 is alpha; layouts without one report their natural maximum so the store macros need no special case.
+#define FETCH_PBM1(s, x, c) ((c) == 3 ? 1u : ((unsigned int)(s)[(x) >> 3] >> (7 - ((x) & 7)) & 1u) ^ 1u)
+#define FETCH_GRAY1(s, x, c) ((c) == 3 ? 1u : (unsigned int)(s)[(x) >> 3] >> (7 - ((x) & 7)) & 1u)
+#define FETCH_GRAY2(s, x, c) ((c) == 3 ? 3u : (unsigned int)(s)[(x) >> 2] >> (6 - 2 * ((x) & 3)) & 3u)
+#define FETCH_GRAY4(s, x, c) ((c) == 3 ? 15u : (unsigned int)(s)[(x) >> 1] >> (4 - 4 * ((x) & 1)) & 15u)
+#define FETCH_GRAY8(s, x, c) ((c) == 3 ? 255u : (unsigned int)(s)[x])
+#define FETCH_GRAY16(s, x, c) ((c) == 3 ? 65535u : BE16(s, x))
+#define FETCH_GRAYA8(s, x, c) ((unsigned int)(s)[2 * (x) + ((c) == 3)])
+#define FETCH_GRAYA16(s, x, c) BE16(s, 2 * (x) + ((c) == 3))
+#define FETCH_RGB8(s, x, c) ((c) == 3 ? 255u : (unsigned int)(s)[3 * (x) + (c)])
+#define FETCH_RGB16(s, x, c) ((c) == 3 ? 65535u : BE16(s, 3 * (x) + (c)))
+#define FETCH_RGBA8(s, x, c) ((unsigned int)(s)[4 * (x) + (c)])
+#define FETCH_RGBA16(s, x, c) BE16(s, 4 * (x) + (c))
+#define FETCH_INDEX1(s, x, c) ((unsigned int)palette[INDEX_INDEX1(s, x)][c])
+#define FETCH_INDEX2(s, x, c) ((unsigned int)palette[INDEX_INDEX2(s, x)][c])
+#define FETCH_INDEX4(s, x, c) ((unsigned int)palette[INDEX_INDEX4(s, x)][c])
+#define FETCH_INDEX8(s, x, c) ((unsigned int)palette[INDEX_INDEX8(s, x)][c])
+
+#define DIRECT8_1(v) ((unsigned char)((v) * 255u))
+#define DIRECT8_2(v) ((unsigned char)((v) * 85u))
+#define DIRECT8_4(v) ((unsigned char)((v) * 17u))
+#define DIRECT8_8(v) ((unsigned char)(v))
+#define DIRECT8_16(v) ((unsigned char)(((v) * 255u + 32895u) >> 16))
+
+#define DIRECT16_1(v) ((unsigned short)((v) * 65535u))
+#define DIRECT16_2(v) ((unsigned short)((v) * 21845u))
+#define DIRECT16_4(v) ((unsigned short)((v) * 4369u))
+#define DIRECT16_8(v) ((unsigned short)((v) * 257u))
+#define DIRECT16_16(v) ((unsigned short)(v))
+
+#define TO8_DIRECT(depth, v) DIRECT8_##depth(v)
+#define TO8_LUT(depth, v) lut8[v]
+#define TO16_DIRECT(depth, v) DIRECT16_##depth(v)
+#define TO16_LUT(depth, v) lut16[v]
+#define TOF_DIRECT(depth, v) ((float)(v) * scale)
+#define TOF_LUT(depth, v) lutf[v]
+
+#define ALPHA8_DIRECT(depth, v) DIRECT8_##depth(v)
+#define ALPHA8_LUT(depth, v) alpha8[v]
+#define ALPHA16_DIRECT(depth, v) DIRECT16_##depth(v)
+#define ALPHA16_LUT(depth, v) alpha16[v]
+#define ALPHAF_DIRECT(depth, v) ((float)(v) * scale)
+#define ALPHAF_LUT(depth, v) alphaf[v]
+
+#define STORE_POINT(transfer, depth, out, x, r, g, b, a) \
+	{ \
+		struct Pixel* px = (struct Pixel*)(out) + (x); \
+		px->x = (float)(x); \
+		px->y = fy; \
+		px->r = TOF_##transfer(depth, r); \
+		px->g = TOF_##transfer(depth, g); \
+		px->b = TOF_##transfer(depth, b); \
+		px->a = ALPHAF_##transfer(depth, a); \
+		px->size = PIXEL_SIZE; \
+	}
+
+#define STORE_RGB8(transfer, depth, out, x, r, g, b, a) \
+	{ \
+		unsigned char* px = (out) + 3 * (size_t)(x); \
+		px[0] = TO8_##transfer(depth, r); \
+		px[1] = TO8_##transfer(depth, g); \
+		px[2] = TO8_##transfer(depth, b); \
+		(void)(a); \
+	}
+
+#define STORE_RGBA8(transfer, depth, out, x, r, g, b, a) \
+	{ \
+		unsigned char* px = (out) + 4 * (size_t)(x); \
+		px[0] = TO8_##transfer(depth, r); \
+		px[1] = TO8_##transfer(depth, g); \
+		px[2] = TO8_##transfer(depth, b); \
+		px[3] = ALPHA8_##transfer(depth, a); \
+	}
+
+#define STORE_GRAY8(transfer, depth, out, x, r, g, b, a) \
+	{ \
+		(out)[x] = TO8_##transfer(depth, r); \
+		(void)(g); \
+		(void)(b); \
+		(void)(a); \
+	}
+
+#define STORE_GRAY16(transfer, depth, out, x, r, g, b, a) \
+	{ \
+		((unsigned short*)(out))[x] = TO16_##transfer(depth, r); \
+		(void)(g); \
+		(void)(b); \
+		(void)(a); \
+	}
+
+#define STORE_RGB16(transfer, depth, out, x, r, g, b, a) \
+	{ \
+		unsigned short* px = (unsigned short*)(out) + 3 * (size_t)(x); \
+		px[0] = TO16_##transfer(depth, r); \
+		px[1] = TO16_##transfer(depth, g); \
+		px[2] = TO16_##transfer(depth, b); \
+		(void)(a); \
+	}
+
+#define STORE_RGBA16(transfer, depth, out, x, r, g, b, a) \
+	{ \
+		unsigned short* px = (unsigned short*)(out) + 4 * (size_t)(x); \
+		px[0] = TO16_##transfer(depth, r); \
+		px[1] = TO16_##transfer(depth, g); \
+		px[2] = TO16_##transfer(depth, b); \
+		px[3] = ALPHA16_##transfer(depth, a); \
+	}
+
+#define STORE_RGBA32F(transfer, depth, out, x, r, g, b, a) \
+	{ \
+		float* px = (float*)(out) + 4 * (size_t)(x); \
+		px[0] = TOF_##transfer(depth, r); \
+		px[1] = TOF_##transfer(depth, g); \
+		px[2] = TOF_##transfer(depth, b); \
+		px[3] = ALPHAF_##transfer(depth, a); \
+	}
+
+#define DEFINE_CONVERTER(layout, depth, format, transfer) \
+	static void convert_##layout##_##format##_##transfer(const unsigned char* restrict src, void* restrict dst, \
+	                                                    const int width, const struct RowContext* ctx) \
+	{ \
+		unsigned char* restrict out = dst; \
+		const unsigned char(*palette)[4] = ctx->palette; \
+		const unsigned char *lut8 = ctx->lut, *alpha8 = ctx->alphaLut; \
+		const unsigned short *lut16 = ctx->lut, *alpha16 = ctx->alphaLut; \
+		const float *lutf = ctx->lut, *alphaf = ctx->alphaLut; \
+		const float scale = ctx->scale, fy = (float)ctx->y; \
+		(void)palette; \
+		(void)lut8; \
+		(void)lut16; \
+		(void)lutf; \
+		(void)alpha8; \
+		(void)alpha16; \
+		(void)alphaf; \
+		(void)scale; \
+		(void)fy; \
+		for (int x = 0; x < width; ++x) \
+		{ \
+			const unsigned int r = FETCH_##layout(src, x, 0), g = FETCH_##layout(src, x, 1), \
+			                   b = FETCH_##layout(src, x, 2), a = FETCH_##layout(src, x, 3); \
+			STORE_##format(transfer, depth, out, x, r, g, b, a) \
+		} \
+	}
+
+#define DEFINE_INDEX_CONVERTER(layout) \
+	static void convert_##layout##_INDEX8(const unsigned char* restrict src, void* restrict dst, const int width, \
+	                                      const struct RowContext* ctx) \
+	{ \
+		unsigned char* restrict out = dst; \
+		(void)ctx; \
+		for (int x = 0; x < width; ++x) out[x] = (unsigned char)INDEX_##layout(src, x); \
+	}
+
+#define DEFINE_CONVERTERS(layout, depth, format) DEFINE_CONVERTERS_##format(layout, depth, format)
+#define DEFINE_CONVERTERS_POINT(layout, depth, format) DEFINE_TRANSFERS(layout, depth, format)
+#define DEFINE_CONVERTERS_RGB8(layout, depth, format) DEFINE_TRANSFERS(layout, depth, format)
+#define DEFINE_CONVERTERS_RGBA8(layout, depth, format) DEFINE_TRANSFERS(layout, depth, format)
+#define DEFINE_CONVERTERS_RGBA32F(layout, depth, format) DEFINE_TRANSFERS(layout, depth, format)
+#define DEFINE_CONVERTERS_GRAY8(layout, depth, format) DEFINE_TRANSFERS(layout, depth, format)
+#define DEFINE_CONVERTERS_GRAY16(layout, depth, format) DEFINE_TRANSFERS(layout, depth, format)
+#define DEFINE_CONVERTERS_RGB16(layout, depth, format) DEFINE_TRANSFERS(layout, depth, format)
+#define DEFINE_CONVERTERS_RGBA16(layout, depth, format) DEFINE_TRANSFERS(layout, depth, format)
+#define DEFINE_CONVERTERS_INDEX8(layout, depth, format) DEFINE_INDEX_CONVERTER(layout)
+
+#define DEFINE_TRANSFERS(layout, depth, format) \
+	DEFINE_CONVERTER(layout, depth, format, DIRECT) \
+	DEFINE_CONVERTER(layout, depth, format, LUT)
+
+#define DEFINE_LAYOUT(layout, depth, formats) formats(DEFINE_CONVERTERS, layout, depth)
+
+ROW_LAYOUTS(DEFINE_LAYOUT)
+
+#define CONVERTER_ENTRY(layout, depth, format) CONVERTER_ENTRY_##format(layout)
+#define CONVERTER_ENTRY_POINT(layout) CONVERTER_TRANSFERS(layout, POINT)
+#define CONVERTER_ENTRY_RGB8(layout) CONVERTER_TRANSFERS(layout, RGB8)
+#define CONVERTER_ENTRY_RGBA8(layout) CONVERTER_TRANSFERS(layout, RGBA8)
+#define CONVERTER_ENTRY_RGBA32F(layout) CONVERTER_TRANSFERS(layout, RGBA32F)
+#define CONVERTER_ENTRY_GRAY8(layout) CONVERTER_TRANSFERS(layout, GRAY8)
+#define CONVERTER_ENTRY_GRAY16(layout) CONVERTER_TRANSFERS(layout, GRAY16)
+#define CONVERTER_ENTRY_RGB16(layout) CONVERTER_TRANSFERS(layout, RGB16)
+#define CONVERTER_ENTRY_RGBA16(layout) CONVERTER_TRANSFERS(layout, RGBA16)
+#define CONVERTER_ENTRY_INDEX8(layout) \
+	[ROW_LAYOUT_##layout][PIXEL_FORMAT_INDEX8] = {convert_##layout##_INDEX8, convert_##layout##_INDEX8},
+
+#define CONVERTER_TRANSFERS(layout, format) \
+	[ROW_LAYOUT_##layout][PIXEL_FORMAT_##format] = {convert_##layout##_##format##_DIRECT, \
+	                                                convert_##layout##_##format##_LUT},
+
+#define CONVERTER_LAYOUT(layout, depth, formats) formats(CONVERTER_ENTRY, layout, depth)
+
+static const RowConverter rowConverters[ROW_LAYOUT_COUNT][PIXEL_FORMAT_COUNT][2] = {ROW_LAYOUTS(CONVERTER_LAYOUT)};
+
+#define LAYOUT_DEPTH(layout, depth, formats) [ROW_LAYOUT_##layout] = depth,
+
+static const unsigned int rowLayoutDepth[ROW_LAYOUT_COUNT] = {ROW_LAYOUTS(LAYOUT_DEPTH)};
+
+size_t getRowLayoutBytes(const enum RowLayout layout, const int width)
+{
+	const size_t w = (size_t)width;
+	switch (layout)
+	{
+		case ROW_LAYOUT_PBM1:
+		case ROW_LAYOUT_GRAY1:
+			return (w + 7) / 8;
+		case ROW_LAYOUT_GRAY2:
+			return (w + 3) / 4;
+		case ROW_LAYOUT_GRAY4:
+			return (w + 1) / 2;
+		case ROW_LAYOUT_GRAY8:
+			return w;
+		case ROW_LAYOUT_GRAY16:
+		case ROW_LAYOUT_GRAYA8:
+			return w * 2;
+		case ROW_LAYOUT_GRAYA16:
+			return w * 4;
+		case ROW_LAYOUT_RGB8:
+			return w * 3;
+		case ROW_LAYOUT_RGB16:
+			return w * 6;
+		case ROW_LAYOUT_RGBA8:
+			return w * 4;
+		case ROW_LAYOUT_RGBA16:
+			return w * 8;
+		case ROW_LAYOUT_INDEX1:
+			return (w + 7) / 8;
+		case ROW_LAYOUT_INDEX2:
+			return (w + 3) / 4;
+		case ROW_LAYOUT_INDEX4:
+			return (w + 1) / 2;
+		case ROW_LAYOUT_INDEX8:
+			return w;
+		default:
+			return 0;
+	}
+}
+
+// Linear light to sRGB for 8-bit samples, the table a gAMA of 1.0 needs for 8-bit images
+static const unsigned char linearToSRGB8[256] = {
+	0, 13, 22, 28, 34, 38, 42, 46, 50, 53, 56, 59, 61, 64, 66, 69,
+	71, 73, 75, 77, 79, 81, 83, 85, 86, 88, 90, 92, 93, 95, 96, 98,
+	99, 101, 102, 104, 105, 106, 108, 109, 110, 112, 113, 114, 115, 117, 118, 119,
+	120, 121, 122, 124, 125, 126, 127, 128, 129, 130, 131, 132, 133, 134, 135, 136,
+	137, 138, 139, 140, 141, 142, 143, 144, 145, 146, 147, 148, 148, 149, 150, 151,
+	152, 153, 154, 155, 155, 156, 157, 158, 159, 159, 160, 161, 162, 163, 163, 164,
+	165, 166, 167, 167, 168, 169, 170, 170, 171, 172, 173, 173, 174, 175, 175, 176,
+	177, 178, 178, 179, 180, 180, 181, 182, 182, 183, 184, 185, 185, 186, 187, 187,
+	188, 189, 189, 190, 190, 191, 192, 192, 193, 194, 194, 195, 196, 196, 197, 197,
+	198, 199, 199, 200, 200, 201, 202, 202, 203, 203, 204, 205, 205, 206, 206, 207,
+	208, 208, 209, 209, 210, 210, 211, 212, 212, 213, 213, 214, 214, 215, 215, 216,
+	216, 217, 218, 218, 219, 219, 220, 220, 221, 221, 222, 222, 223, 223, 224, 224,
+	225, 226, 226, 227, 227, 228, 228, 229, 229, 230, 230, 231, 231, 232, 232, 233,
+	233, 234, 234, 235, 235, 236, 236, 237, 237, 238, 238, 238, 239, 239, 240, 240,
+	241, 241, 242, 242, 243, 243, 244, 244, 245, 245, 246, 246, 246, 247, 247, 248,
+	248, 249, 249, 250, 250, 251, 251, 251, 252, 252, 253, 253, 254, 254, 255, 255,
+};
+
+enum TransferOutput
+{
+	TRANSFER_OUTPUT_8 = 0,
+	TRANSFER_OUTPUT_16,
+	TRANSFER_OUTPUT_FLOAT
+};
+
+struct TransferTable
+{
+	enum TransferOutput output;
+	unsigned int naturalMax, maxVal;
+	float gamma;
+	const void* table;
+};
+
+#define TRANSFER_TABLE_SLOTS 16
+
+static struct TransferTable transferTables[TRANSFER_TABLE_SLOTS];
+static int transferTableCount = 0;
+static pthread_mutex_t transferTableLock = PTHREAD_MUTEX_INITIALIZER;
+
+static enum TransferOutput getTransferOutput(const enum PixelFormat format)
+{
+	switch (format)
+	{
+		case PIXEL_FORMAT_RGB8:
+		case PIXEL_FORMAT_RGBA8:
+		case PIXEL_FORMAT_GRAY8:
+			return TRANSFER_OUTPUT_8;
+		case PIXEL_FORMAT_GRAY16:
+		case PIXEL_FORMAT_RGB16:
+		case PIXEL_FORMAT_RGBA16:
+			return TRANSFER_OUTPUT_16;
+		default:
+			return TRANSFER_OUTPUT_FLOAT;
+	}
+}
+
+// Decodes a sample encoded with `gamma` to linear light and re-encodes it for an sRGB display; 0 leaves it as is
+static double applyTransfer(const double v, const float gamma)
+{
+	if (gamma <= 0.0f) return v;
+
+	const double linear = pow(v, 1.0 / gamma);
+	return linear <= 0.0031308 ? linear * 12.92 : 1.055 * pow(linear, 1.0 / 2.4) - 0.055;
+}
+
+static void* buildTransferTable(const enum TransferOutput output, const unsigned int naturalMax,
+                                const unsigned int maxVal, const float gamma)
+{
+	const size_t entries = (size_t)naturalMax + 1;
+	const size_t entrySize = output == TRANSFER_OUTPUT_8 ? 1 : output == TRANSFER_OUTPUT_16 ? 2 : sizeof(float);
+	void* table = malloc(entries * entrySize);
+	if (!table)
+	{
+		fprintf(stderr, "Failed to allocate conversion table\n");
+		return NULL;
+	}
+
+	for (size_t v = 0; v < entries; ++v)
+	{
+		const double c = v >= maxVal ? 1.0 : applyTransfer((double)v / maxVal, gamma);
+		if (output == TRANSFER_OUTPUT_8) ((unsigned char*)table)[v] = (unsigned char)(c * 255.0 + 0.5);
+		else if (output == TRANSFER_OUTPUT_16) ((unsigned short*)table)[v] = (unsigned short)(c * 65535.0 + 0.5);
+		else ((float*)table)[v] = (float)c;
+	}
+
+	return table;
+}
+
+// Tables are built once per (output, depth, maxVal, gamma) and shared by every later conversion. Once the slots are
+// full a table is built for the caller alone and handed back through `owned`.
+static const void* getTransferTable(const enum TransferOutput output, const unsigned int naturalMax,
+                                    const unsigned int maxVal, const float gamma, void** owned)
+{
+	*owned = NULL;
+	if (output == TRANSFER_OUTPUT_8 && naturalMax == 255 && maxVal == 255 && gamma == 1.0f) return linearToSRGB8;
+
+	pthread_mutex_lock(&transferTableLock);
+	for (int i = 0; i < transferTableCount; ++i)
+	{
+		const struct TransferTable* t = &transferTables[i];
+		if (t->output == output && t->naturalMax == naturalMax && t->maxVal == maxVal && t->gamma == gamma)
+		{
+			pthread_mutex_unlock(&transferTableLock);
+			return t->table;
+		}
+	}
+
+	void* table = buildTransferTable(output, naturalMax, maxVal, gamma);
+	if (table && transferTableCount < TRANSFER_TABLE_SLOTS)
+		transferTables[transferTableCount++] = (struct TransferTable){output, naturalMax, maxVal, gamma, table};
+	else *owned = table;
+	pthread_mutex_unlock(&transferTableLock);
+
+	return table;
+}
+
+int applyPaletteTransfer(unsigned char (*palette)[4], const int count, const float gamma)
+{
+	if (gamma <= 0.0f) return 1;
+
+	void* owned;
+	const unsigned char* lut = getTransferTable(TRANSFER_OUTPUT_8, 255, 255, gamma, &owned);
+	if (!lut) return 0;
+
+	for (int i = 0; i < count; ++i)
+		for (int c = 0; c < 3; ++c) palette[i][c] = lut[palette[i][c]];
+	free(owned);
+
+	return 1;
+}
+
+int initRowConversion(struct RowConversion* out, const enum RowLayout layout, const enum PixelFormat format,
+                      const unsigned int maxVal, const float gamma)
+{
+	if (!out || (unsigned int)layout >= ROW_LAYOUT_COUNT || (unsigned int)format >= PIXEL_FORMAT_COUNT || !maxVal)
+		return 0;
+
+	const unsigned int naturalMax = (1u << rowLayoutDepth[layout]) - 1u;
+	const int useLUT = maxVal != naturalMax || gamma > 0.0f;
+
+	out->convert = rowConverters[layout][format][useLUT];
+	if (!out->convert)
+	{
+		fprintf(stderr, "Unsupported row conversion: layout %d to pixel format %d\n", (int)layout, (int)format);
+		return 0;
+	}
+
+	out->ctx.y = 0;
+	out->ctx.palette = NULL;
+	out->ctx.scale = 1.0f / (float)maxVal;
+	out->ctx.lut = NULL;
+	out->ctx.alphaLut = NULL;
+	out->owned[0] = out->owned[1] = NULL;
+
+	if (!useLUT || format == PIXEL_FORMAT_INDEX8) return 1;
+
+	const enum TransferOutput output = getTransferOutput(format);
+	out->ctx.lut = getTransferTable(output, naturalMax, maxVal, gamma > 0.0f ? gamma : 0.0f, &out->owned[0]);
+	out->ctx.alphaLut = gamma > 0.0f ? getTransferTable(output, naturalMax, maxVal, 0.0f, &out->owned[1])
+	                                 : out->ctx.lut;
+	if (!out->ctx.lut || !out->ctx.alphaLut)
+	{
+		freeRowConversion(out);
+		return 0;
+	}
+
+	return 1;
+}
+
+void freeRowConversion(struct RowConversion* conversion)
+{
+	if (!conversion) return;
+
+	free(conversion->owned[0]);
+	free(conversion->owned[1]);
+	conversion->owned[0] = conversion->owned[1] = NULL;
+	conversion->ctx.lut = NULL;
+	conversion->ctx.alphaLut = NULL;
+}
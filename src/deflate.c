@@ -0,0 +1,623 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "./include/checksum.h"
+#include "./include/deflate.h"
+
+#define DEFLATE_WINDOW 32768
+#define DEFLATE_WINDOW_MASK (DEFLATE_WINDOW - 1)
+#define DEFLATE_HASH_BITS 15
+#define DEFLATE_MAX_CHAIN 24
+#define DEFLATE_MIN_MATCH 3
+#define DEFLATE_MAX_MATCH 258
+// Input bytes each worker compresses independently, and the most symbols one Huffman block is built for
+#define DEFLATE_CHUNK_SIZE (256 * 1024)
+#define DEFLATE_BLOCK_TOKENS 16384
+#define DEFLATE_MAX_THREADS 64
+
+struct Token
+{
+	uint16_t value, dist; // a literal byte when dist is 0, otherwise a match length
+};
+
+struct BitWriter
+{
+	unsigned char *out, *end;
+	uint64_t bits;
+	int count, overflow;
+};
+
+struct Deflater
+{
+	const unsigned char* base; // start of the dictionary, the chunk follows it
+	int32_t head[1 << DEFLATE_HASH_BITS], prev[DEFLATE_WINDOW];
+	struct Token tokens[DEFLATE_BLOCK_TOKENS];
+	int tokenCount;
+	unsigned int litLenFreq[286], distFreq[30];
+	struct BitWriter writer;
+};
+
+struct DeflateChunk
+{
+	const unsigned char* src;
+	size_t dictSize, size, outSize;
+	unsigned char* out;
+	unsigned int adler;
+	int last, ok;
+};
+
+struct DeflateJob
+{
+	struct DeflateChunk* chunks;
+	int first, count, step;
+};
+
+static const uint16_t lengthBase[29] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t lengthExtra[29] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t distBase[30] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+	8193, 12289, 16385, 24577
+};
+static const uint8_t distExtra[30] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+static const uint8_t codeLengthOrder[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+// Symbol lookups: lengths directly, distances below 257 directly and the rest by their upper bits
+static uint8_t lengthSymbol[DEFLATE_MAX_MATCH + 1], distSymbol[512];
+static pthread_once_t symbolTablesOnce = PTHREAD_ONCE_INIT;
+
+static void buildSymbolTables(void)
+{
+	for (int s = 0; s < 29; ++s)
+		for (int l = lengthBase[s]; l < lengthBase[s] + (1 << lengthExtra[s]) && l <= DEFLATE_MAX_MATCH; ++l)
+			lengthSymbol[l] = (uint8_t)s;
+	lengthSymbol[DEFLATE_MAX_MATCH] = 28;
+
+	for (int s = 0; s < 30; ++s)
+		for (int d = distBase[s]; d < distBase[s] + (1 << distExtra[s]); ++d)
+		{
+			if (d <= 256) distSymbol[d - 1] = (uint8_t)s;
+			else distSymbol[256 + ((d - 1) >> 7)] = (uint8_t)s;
+		}
+}
+
+static int getDistSymbol(const int dist)
+{
+	return dist <= 256 ? distSymbol[dist - 1] : distSymbol[256 + ((dist - 1) >> 7)];
+}
+
+static void putBits(struct BitWriter* w, const unsigned int value, const int n)
+{
+	w->bits |= (uint64_t)value << w->count;
+	w->count += n;
+	while (w->count >= 8)
+	{
+		if (w->out < w->end) *w->out++ = (unsigned char)w->bits;
+		else w->overflow = 1;
+		w->bits >>= 8;
+		w->count -= 8;
+	}
+}
+
+static void alignBits(struct BitWriter* w)
+{
+	if (w->count) putBits(w, 0, 8 - w->count);
+}
+
+// In-place minimum-redundancy code lengths (Moffat and Katajainen) for weights sorted in ascending order
+static void computeCodeLengths(unsigned int* a, const int n)
+{
+	if (n == 1)
+	{
+		a[0] = 1;
+		return;
+	}
+
+	a[0] += a[1];
+	int root = 0, leaf = 2;
+	for (int next = 1; next < n - 1; ++next)
+	{
+		if (leaf >= n || a[root] < a[leaf])
+		{
+			a[next] = a[root];
+			a[root++] = (unsigned int)next;
+		}
+		else a[next] = a[leaf++];
+
+		if (leaf >= n || (root < next && a[root] < a[leaf]))
+		{
+			a[next] += a[root];
+			a[root++] = (unsigned int)next;
+		}
+		else a[next] += a[leaf++];
+	}
+
+	a[n - 2] = 0;
+	for (int next = n - 3; next >= 0; --next) a[next] = a[a[next]] + 1;
+
+	int available = 1, used = 0, depth = 0, next = n - 1;
+	root = n - 2;
+	while (available > 0)
+	{
+		while (root >= 0 && a[root] == (unsigned int)depth)
+		{
+			used++;
+			root--;
+		}
+		while (available > used)
+		{
+			a[next--] = (unsigned int)depth;
+			available--;
+		}
+
+		available = 2 * used;
+		depth++;
+		used = 0;
+	}
+}
+
+static int compareWeights(const void* a, const void* b)
+{
+	const uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+	return (x > y) - (x < y);
+}
+
+// Code lengths no longer than `limit` for the given symbol frequencies. At least two symbols always get a code, so
+// every code is complete even when a block uses a single distance or none at all.
+static void buildLengths(const unsigned int* freq, const int count, const int limit, uint8_t* lengths)
+{
+	// Frequency in the upper bits and symbol in the lower ones sorts both at once
+	uint32_t sorted[286];
+	unsigned int weights[286];
+	int n = 0;
+	for (int i = 0; i < count; ++i)
+		if (freq[i]) sorted[n++] = (freq[i] < 0xFFFF ? freq[i] : 0xFFFF) << 9 | (uint32_t)i;
+	for (int i = 0; n < 2; ++i)
+		if (!freq[i]) sorted[n++] = 1u << 9 | (uint32_t)i;
+
+	qsort(sorted, (size_t)n, sizeof(*sorted), compareWeights);
+	for (int i = 0; i < n; ++i) weights[i] = sorted[i] >> 9;
+	computeCodeLengths(weights, n);
+
+	// Fold any code longer than the limit into it, then lengthen the shortest codes until the Kraft sum is exact again
+	int lengthCount[33] = {0};
+	for (int i = 0; i < n; ++i) lengthCount[weights[i] < 32 ? weights[i] : 32]++;
+	for (int l = limit + 1; l <= 32; ++l)
+	{
+		lengthCount[limit] += lengthCount[l];
+		lengthCount[l] = 0;
+	}
+
+	uint32_t total = 0;
+	for (int l = limit; l > 0; --l) total += (uint32_t)lengthCount[l] << (limit - l);
+	while (total != 1u << limit)
+	{
+		lengthCount[limit]--;
+		for (int l = limit - 1; l > 0; --l)
+			if (lengthCount[l])
+			{
+				lengthCount[l]--;
+				lengthCount[l + 1] += 2;
+				break;
+			}
+		total--;
+	}
+
+	memset(lengths, 0, (size_t)count);
+	int at = 0;
+	for (int l = limit; l > 0; --l)
+		for (int k = 0; k < lengthCount[l]; ++k) lengths[sorted[at++] & 511] = (uint8_t)l;
+}
+
+// Canonical codes, bit-reversed since deflate sends Huffman codes starting from their most significant bit
+static void buildCodes(const uint8_t* lengths, const int count, uint16_t* codes)
+{
+	int lengthCount[16] = {0}, next[16];
+	for (int i = 0; i < count; ++i) lengthCount[lengths[i]]++;
+	lengthCount[0] = 0;
+
+	int code = 0;
+	for (int l = 1; l < 16; ++l)
+	{
+		code = (code + lengthCount[l - 1]) << 1;
+		next[l] = code;
+	}
+
+	for (int i = 0; i < count; ++i)
+	{
+		const int l = lengths[i];
+		if (!l) continue;
+
+		int c = next[l]++, r = 0;
+		for (int b = 0; b < l; ++b, c >>= 1) r = r << 1 | (c & 1);
+		codes[i] = (uint16_t)r;
+	}
+}
+
+// Run-length codes the literal/length and distance code lengths with symbols 16-18; returns the symbol count
+static int encodeCodeLengths(const uint8_t* lengths, const int count, uint8_t* symbols, uint8_t* extra,
+                             unsigned int* freq)
+{
+	int n = 0;
+	for (int i = 0; i < count;)
+	{
+		const uint8_t l = lengths[i];
+		int run = 1;
+		while (i + run < count && lengths[i + run] == l) run++;
+		i += run;
+
+		if (l == 0)
+			while (run >= 3)
+			{
+				const int take = run < 138 ? run : 138;
+				symbols[n] = take >= 11 ? 18 : 17;
+				extra[n] = (uint8_t)(take >= 11 ? take - 11 : take - 3);
+				freq[symbols[n++]]++;
+				run -= take;
+			}
+		else
+		{
+			symbols[n] = l;
+			extra[n++] = 0;
+			freq[l]++;
+			run--;
+			while (run >= 3)
+			{
+				const int take = run < 6 ? run : 6;
+				symbols[n] = 16;
+				extra[n++] = (uint8_t)(take - 3);
+				freq[16]++;
+				run -= take;
+			}
+		}
+
+		for (; run > 0; --run)
+		{
+			symbols[n] = l;
+			extra[n++] = 0;
+			freq[l]++;
+		}
+	}
+
+	return n;
+}
+
+static void writeStored(struct BitWriter* w, const unsigned char* src, size_t size, const int final)
+{
+	do
+	{
+		const size_t n = size < 65535 ? size : 65535;
+		putBits(w, final && n == size, 1);
+		putBits(w, 0, 2);
+		alignBits(w);
+		putBits(w, (unsigned int)n, 16);
+		putBits(w, (unsigned int)n ^ 0xFFFF, 16);
+
+		if ((size_t)(w->end - w->out) >= n)
+		{
+			if (n) memcpy(w->out, src, n);
+			w->out += n;
+		}
+		else w->overflow = 1;
+		src += n;
+		size -= n;
+	}
+	while (size);
+}
+
+static void writeTokens(struct BitWriter* w, const struct Token* tokens, const int count, const uint8_t* litLenLengths,
+                        const uint16_t* litLenCodes, const uint8_t* distLengths, const uint16_t* distCodes)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		const struct Token t = tokens[i];
+		if (!t.dist)
+		{
+			putBits(w, litLenCodes[t.value], litLenLengths[t.value]);
+			continue;
+		}
+
+		const int ls = lengthSymbol[t.value], ds = getDistSymbol(t.dist);
+		putBits(w, litLenCodes[257 + ls], litLenLengths[257 + ls]);
+		putBits(w, t.value - lengthBase[ls], lengthExtra[ls]);
+		putBits(w, distCodes[ds], distLengths[ds]);
+		putBits(w, t.dist - distBase[ds], distExtra[ds]);
+	}
+	putBits(w, litLenCodes[256], litLenLengths[256]);
+}
+
+static uint64_t getTokenBits(const struct Deflater* d, const uint8_t* litLenLengths, const uint8_t* distLengths)
+{
+	uint64_t bits = 0;
+	for (int s = 0; s < 286; ++s)
+		bits += (uint64_t)d->litLenFreq[s] * (litLenLengths[s] + (s > 256 ? lengthExtra[s - 257] : 0));
+	for (int s = 0; s < 30; ++s) bits += (uint64_t)d->distFreq[s] * (distLengths[s] + distExtra[s]);
+
+	return bits;
+}
+
+// Emits the pending tokens, which cover src[begin, end), as whichever of a dynamic, fixed or stored block is smallest
+static void flushBlock(struct Deflater* d, const size_t begin, const size_t end, const int final)
+{
+	struct BitWriter* w = &d->writer;
+	d->litLenFreq[256] = 1;
+
+	uint8_t litLenLengths[286], distLengths[30], codeLengths[286 + 30], clLengths[19];
+	uint8_t clSymbols[286 + 30], clExtra[286 + 30];
+	unsigned int clFreq[19] = {0};
+	buildLengths(d->litLenFreq, 286, 15, litLenLengths);
+	buildLengths(d->distFreq, 30, 15, distLengths);
+
+	int hlit = 286, hdist = 30, hclen = 19;
+	while (hlit > 257 && !litLenLengths[hlit - 1]) hlit--;
+	while (hdist > 1 && !distLengths[hdist - 1]) hdist--;
+	memcpy(codeLengths, litLenLengths, (size_t)hlit);
+	memcpy(codeLengths + hlit, distLengths, (size_t)hdist);
+	const int clCount = encodeCodeLengths(codeLengths, hlit + hdist, clSymbols, clExtra, clFreq);
+	buildLengths(clFreq, 19, 7, clLengths);
+	while (hclen > 4 && !clLengths[codeLengthOrder[hclen - 1]]) hclen--;
+
+	uint64_t dynamicBits = 3 + 14 + 3 * (uint64_t)hclen + getTokenBits(d, litLenLengths, distLengths);
+	for (int i = 0; i < clCount; ++i)
+		dynamicBits += clLengths[clSymbols[i]] + (clSymbols[i] == 16 ? 2 : clSymbols[i] == 17 ? 3 : clSymbols[i] == 18 ? 7 : 0);
+
+	uint8_t fixedLitLen[288], fixedDist[30];
+	memset(fixedLitLen, 8, 144);
+	memset(fixedLitLen + 144, 9, 112);
+	memset(fixedLitLen + 256, 7, 24);
+	memset(fixedLitLen + 280, 8, 8);
+	memset(fixedDist, 5, 30);
+	const uint64_t fixedBits = 3 + getTokenBits(d, fixedLitLen, fixedDist);
+	const uint64_t storedBits = ((end - begin) / 65535 + 1) * 40 + 7 + (uint64_t)(end - begin) * 8;
+
+	if (storedBits <= dynamicBits && storedBits <= fixedBits) writeStored(w, d->base + begin, end - begin, final);
+	else
+	{
+		uint16_t litLenCodes[288], distCodes[30];
+		const uint8_t *litLen = fixedLitLen, *dist = fixedDist;
+		putBits(w, (unsigned int)final, 1);
+		if (fixedBits <= dynamicBits) putBits(w, 1, 2);
+		else
+		{
+			uint16_t clCodes[19];
+			buildCodes(clLengths, 19, clCodes);
+			putBits(w, 2, 2);
+			putBits(w, (unsigned int)(hlit - 257), 5);
+			putBits(w, (unsigned int)(hdist - 1), 5);
+			putBits(w, (unsigned int)(hclen - 4), 4);
+			for (int i = 0; i < hclen; ++i) putBits(w, clLengths[codeLengthOrder[i]], 3);
+			for (int i = 0; i < clCount; ++i)
+			{
+				putBits(w, clCodes[clSymbols[i]], clLengths[clSymbols[i]]);
+				if (clSymbols[i] >= 16) putBits(w, clExtra[i], clSymbols[i] == 16 ? 2 : clSymbols[i] == 17 ? 3 : 7);
+			}
+
+			litLen = litLenLengths;
+			dist = distLengths;
+		}
+
+		buildCodes(litLen, litLen == fixedLitLen ? 288 : 286, litLenCodes);
+		buildCodes(dist, 30, distCodes);
+		writeTokens(w, d->tokens, d->tokenCount, litLen, litLenCodes, dist, distCodes);
+	}
+
+	d->tokenCount = 0;
+	memset(d->litLenFreq, 0, sizeof(d->litLenFreq));
+	memset(d->distFreq, 0, sizeof(d->distFreq));
+}
+
+static uint32_t hash3(const unsigned char* p)
+{
+	return ((uint32_t)p[0] << 16 | (uint32_t)p[1] << 8 | p[2]) * 2654435761u >> (32 - DEFLATE_HASH_BITS);
+}
+
+static void insertPosition(struct Deflater* d, const int32_t pos)
+{
+	const uint32_t h = hash3(d->base + pos);
+	d->prev[pos & DEFLATE_WINDOW_MASK] = d->head[h];
+	d->head[h] = pos;
+}
+
+// Longest match for `pos` along its hash chain, no longer than `limit`
+static int findMatch(const struct Deflater* d, const int32_t pos, const int limit, int* dist)
+{
+	const unsigned char* cur = d->base + pos;
+	int best = DEFLATE_MIN_MATCH - 1, chain = DEFLATE_MAX_CHAIN;
+	int32_t candidate = d->head[hash3(cur)];
+
+	while (candidate >= 0 && pos - candidate <= DEFLATE_WINDOW && chain--)
+	{
+		const unsigned char* p = d->base + candidate;
+		if (p[best] == cur[best] && p[0] == cur[0] && p[1] == cur[1])
+		{
+			int len = 2;
+			while (len < limit && p[len] == cur[len]) len++;
+			if (len > best)
+			{
+				best = len;
+				*dist = pos - candidate;
+				if (len == limit) break;
+			}
+		}
+
+		const int32_t next = d->prev[candidate & DEFLATE_WINDOW_MASK];
+		if (next >= candidate) break;
+		candidate = next;
+	}
+
+	return best >= DEFLATE_MIN_MATCH ? best : 0;
+}
+
+// Greedy LZ77 over one chunk. Every chunk but the last ends with an empty stored block, which byte-aligns it so the
+// chunks can simply be concatenated.
+static int compressChunk(struct Deflater* d, struct DeflateChunk* chunk)
+{
+	d->base = chunk->src - chunk->dictSize;
+	d->tokenCount = 0;
+	memset(d->head, 0xFF, sizeof(d->head));
+	memset(d->litLenFreq, 0, sizeof(d->litLenFreq));
+	memset(d->distFreq, 0, sizeof(d->distFreq));
+
+	const size_t bound = chunk->size + chunk->size / 1024 + 64;
+	chunk->out = malloc(bound);
+	if (!chunk->out) return 0;
+	d->writer = (struct BitWriter){chunk->out, chunk->out + bound, 0, 0, 0};
+
+	const int32_t end = (int32_t)(chunk->dictSize + chunk->size);
+	for (int32_t pos = 0; pos < (int32_t)chunk->dictSize && pos + DEFLATE_MIN_MATCH <= end; ++pos)
+		insertPosition(d, pos);
+
+	size_t blockBegin = chunk->dictSize;
+	for (int32_t pos = (int32_t)chunk->dictSize; pos < end;)
+	{
+		const int limit = end - pos < DEFLATE_MAX_MATCH ? end - pos : DEFLATE_MAX_MATCH;
+		int dist = 0, len = 0;
+		if (limit >= DEFLATE_MIN_MATCH)
+		{
+			len = findMatch(d, pos, limit, &dist);
+			insertPosition(d, pos);
+		}
+
+		struct Token* t = &d->tokens[d->tokenCount++];
+		if (len)
+		{
+			t->value = (uint16_t)len;
+			t->dist = (uint16_t)dist;
+			d->litLenFreq[257 + lengthSymbol[len]]++;
+			d->distFreq[getDistSymbol(dist)]++;
+
+			for (int32_t i = pos + 1; i < pos + len && i + DEFLATE_MIN_MATCH <= end; ++i) insertPosition(d, i);
+			pos += len;
+		}
+		else
+		{
+			t->value = d->base[pos];
+			t->dist = 0;
+			d->litLenFreq[t->value]++;
+			pos++;
+		}
+
+		if (d->tokenCount == DEFLATE_BLOCK_TOKENS || pos == end)
+		{
+			flushBlock(d, blockBegin, (size_t)pos, chunk->last && pos == end);
+			blockBegin = (size_t)pos;
+		}
+	}
+
+	if (!chunk->size && chunk->last)
+	{
+		// An empty final block with fixed codes: just the end-of-block symbol
+		putBits(&d->writer, 3, 3);
+		putBits(&d->writer, 0, 7);
+	}
+	else if (!chunk->last) writeStored(&d->writer, chunk->src, 0, 0);
+	alignBits(&d->writer);
+
+	chunk->outSize = (size_t)(d->writer.out - chunk->out);
+	chunk->adler = updateAdler32(1, chunk->src, chunk->size);
+	return !d->writer.overflow;
+}
+
+static void* deflateWorker(void* arg)
+{
+	const struct DeflateJob* job = arg;
+	struct Deflater* d = malloc(sizeof(*d));
+	for (int i = job->first; i < job->count; i += job->step) job->chunks[i].ok = d && compressChunk(d, &job->chunks[i]);
+	free(d);
+
+	return NULL;
+}
+
+int deflateZlib(const unsigned char* src, const size_t size, int threads, unsigned char** out, size_t* outSize)
+{
+	if ((!src && size) || !out || !outSize) return 0;
+	pthread_once(&symbolTablesOnce, buildSymbolTables);
+
+	const size_t chunkCount = size ? (size + DEFLATE_CHUNK_SIZE - 1) / DEFLATE_CHUNK_SIZE : 1;
+	if (chunkCount > INT32_MAX)
+	{
+		fprintf(stderr, "Deflate input too large: %zu bytes\n", size);
+		return 0;
+	}
+
+	struct DeflateChunk* chunks = calloc(chunkCount, sizeof(*chunks));
+	if (!chunks)
+	{
+		fprintf(stderr, "Failed to allocate memory for deflate\n");
+		return 0;
+	}
+
+	for (size_t i = 0; i < chunkCount; ++i)
+	{
+		const size_t begin = i * DEFLATE_CHUNK_SIZE;
+		chunks[i].src = src + begin;
+		chunks[i].size = size - begin < DEFLATE_CHUNK_SIZE ? size - begin : DEFLATE_CHUNK_SIZE;
+		chunks[i].dictSize = begin < DEFLATE_WINDOW ? begin : DEFLATE_WINDOW;
+		chunks[i].last = i == chunkCount - 1;
+	}
+
+	if (threads > DEFLATE_MAX_THREADS) threads = DEFLATE_MAX_THREADS;
+	if (threads > (int)chunkCount) threads = (int)chunkCount;
+	if (threads < 1) threads = 1;
+
+	// The calling thread takes the first share itself
+	struct DeflateJob jobs[DEFLATE_MAX_THREADS];
+	pthread_t workers[DEFLATE_MAX_THREADS];
+	int started[DEFLATE_MAX_THREADS] = {0};
+	for (int i = 0; i < threads; ++i) jobs[i] = (struct DeflateJob){chunks, i, (int)chunkCount, threads};
+	for (int i = 1; i < threads; ++i) started[i] = pthread_create(&workers[i], NULL, deflateWorker, &jobs[i]) == 0;
+
+	deflateWorker(&jobs[0]);
+	for (int i = 1; i < threads; ++i)
+	{
+		if (started[i]) pthread_join(workers[i], NULL);
+		else deflateWorker(&jobs[i]);
+	}
+
+	size_t total = 6;
+	int ok = 1;
+	for (size_t i = 0; i < chunkCount; ++i)
+	{
+		ok &= chunks[i].ok;
+		total += chunks[i].outSize;
+	}
+
+	unsigned char* stream = ok ? malloc(total) : NULL;
+	if (stream)
+	{
+		// zlib header for a 32 KiB window and the "fast" level hint
+		stream[0] = 0x78;
+		stream[1] = 0x5E;
+
+		size_t at = 2;
+		unsigned int adler = 1;
+		for (size_t i = 0; i < chunkCount; ++i)
+		{
+			memcpy(stream + at, chunks[i].out, chunks[i].outSize);
+			at += chunks[i].outSize;
+			adler = combineAdler32(adler, chunks[i].adler, chunks[i].size);
+		}
+
+		stream[at++] = (unsigned char)(adler >> 24);
+		stream[at++] = (unsigned char)(adler >> 16);
+		stream[at++] = (unsigned char)(adler >> 8);
+		stream[at] = (unsigned char)adler;
+
+		*out = stream;
+		*outSize = total;
+	}
+	else fprintf(stderr, "Failed to deflate %zu bytes\n", size);
+
+	for (size_t i = 0; i < chunkCount; ++i) free(chunks[i].out);
+	free(chunks);
+
+	return stream != NULL;
+}
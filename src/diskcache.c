@@ -0,0 +1,201 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "./include/cache.h"
+#include "./include/diskcache.h"
+
+#define DISK_CACHE_VERSION 2
+#define DISK_CACHE_HEADER_SIZE 4096
+#define DISK_CACHE_PATH_MAX 4096
+
+static const char diskCacheMagic[8] = {'I', 'P', 'C', 'A', 'C', 'H', 'E', '\0'};
+
+// Pixels follow the header at DISK_CACHE_HEADER_SIZE, which keeps them page aligned once mapped. `format` is the
+// resolved format of the pixels; the requested one (possibly PIXEL_FORMAT_NATIVE) only goes into the file name.
+struct DiskCacheHeader
+{
+	char magic[8];
+	uint32_t version, headerSize;
+	uint64_t sourceSize, contentHash;
+	int64_t sourceMtime;
+	int32_t type, width, height, maxVal, format, nativeFormat;
+	int32_t bitDepth, colorType, paletteSize, reserved;
+	uint64_t stride, size;
+	unsigned char palette[256][4];
+};
+
+_Static_assert(sizeof(struct DiskCacheHeader) <= DISK_CACHE_HEADER_SIZE, "disk cache header does not fit");
+
+static int getCachePath(const char* cacheDir, const char* path, const enum PixelFormat format, char* out,
+                        const size_t outSize)
+{
+	char absolute[DISK_CACHE_PATH_MAX];
+	if (!getAbsolutePath(path, absolute, sizeof(absolute))) return 0;
+
+	const uint64_t key = hashBytes(absolute, strlen(absolute), 0);
+	const int n = format == PIXEL_FORMAT_NATIVE
+		              ? snprintf(out, outSize, "%s/%016llx-native.ipc", cacheDir, (unsigned long long)key)
+		              : snprintf(out, outSize, "%s/%016llx-%d.ipc", cacheDir, (unsigned long long)key, (int)format);
+
+	return n > 0 && (size_t)n < outSize;
+}
+
+// With no content hash only the size and mtime stamp is trusted, so a hit never has to read the source image. When
+// the stamp moved (a touch, a fresh checkout) the caller retries with the source's hash and the header is refreshed.
+static int loadCacheFile(const char* cachePath, const struct FileStamp* stamp, const uint64_t* contentHash,
+                         const enum PixelFormat format, struct DiskCachedImage* out)
+{
+	if (!mapFile(cachePath, &out->file)) return 0;
+
+	const struct DiskCacheHeader* header = out->file.data;
+	const int valid = out->file.size >= DISK_CACHE_HEADER_SIZE &&
+		memcmp(header->magic, diskCacheMagic, sizeof(diskCacheMagic)) == 0 &&
+		header->version == DISK_CACHE_VERSION && header->headerSize == DISK_CACHE_HEADER_SIZE &&
+		header->sourceSize == stamp->size &&
+		(format == PIXEL_FORMAT_NATIVE ? header->format == header->nativeFormat : header->format == (int32_t)format) &&
+		header->format >= 0 && header->format < PIXEL_FORMAT_COUNT && header->width > 0 && header->height > 0 &&
+		header->stride >= (uint64_t)header->width * getPixelFormatSize((enum PixelFormat)header->format) &&
+		header->stride <= (out->file.size - DISK_CACHE_HEADER_SIZE) / (uint64_t)header->height &&
+		header->size == header->stride * (uint64_t)header->height &&
+		header->size <= out->file.size - DISK_CACHE_HEADER_SIZE;
+	const int fresh = contentHash ? header->contentHash == *contentHash : header->sourceMtime == stamp->mtime;
+
+	if (!valid || !fresh)
+	{
+		unmapFile(&out->file);
+		return 0;
+	}
+
+	memset(&out->info, 0, sizeof(out->info));
+	out->info.type = header->type;
+	out->info.width = header->width;
+	out->info.height = header->height;
+	out->info.maxVal = header->maxVal;
+	out->info.bitDepth = header->bitDepth;
+	out->info.colorType = header->colorType;
+	out->info.format = (enum PixelFormat)header->format;
+	out->info.nativeFormat = (enum PixelFormat)header->nativeFormat;
+	out->info.paletteSize = header->paletteSize;
+	memcpy(out->info.palette, header->palette, sizeof(out->info.palette));
+	out->info.stride = (size_t)header->stride;
+	out->info.size = (size_t)header->size;
+	out->pixels = (unsigned char*)out->file.data + DISK_CACHE_HEADER_SIZE;
+
+	if (contentHash && header->sourceMtime != stamp->mtime)
+	{
+		FILE* file = fopen(cachePath, "r+b");
+		if (file)
+		{
+			const int64_t mtime = stamp->mtime;
+			if (fseek(file, (long)offsetof(struct DiskCacheHeader, sourceMtime), SEEK_SET) == 0)
+				fwrite(&mtime, sizeof(mtime), 1, file);
+			fclose(file);
+		}
+	}
+
+	return 1;
+}
+
+// Decodes straight into a mapping of a temporary file and publishes it with a rename, so concurrent readers only ever
+// see complete cache files.
+static int writeCacheFile(const char* cachePath, const struct FileStamp* stamp, const uint64_t contentHash,
+                          const unsigned char* data, const size_t size, const enum PixelFormat format)
+{
+	struct ImageInfo info;
+	if (!getImageInfo(data, size, format, &info)) return 0;
+	if (info.size > SIZE_MAX - DISK_CACHE_HEADER_SIZE) return 0;
+
+	char tempPath[DISK_CACHE_PATH_MAX];
+	const int n = snprintf(tempPath, sizeof(tempPath), "%s.%lu.tmp", cachePath, getProcessId());
+	if (n <= 0 || (size_t)n >= sizeof(tempPath)) return 0;
+
+	struct MappedFile file;
+	if (!createMappedFile(tempPath, DISK_CACHE_HEADER_SIZE + info.size, &file))
+	{
+		fprintf(stderr, "Failed to create cache file: %s\n", tempPath);
+		return 0;
+	}
+
+	const int ok = parseImageInto(data, size, &info, (unsigned char*)file.data + DISK_CACHE_HEADER_SIZE, info.stride);
+	if (ok)
+	{
+		struct DiskCacheHeader header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, diskCacheMagic, sizeof(diskCacheMagic));
+		header.version = DISK_CACHE_VERSION;
+		header.headerSize = DISK_CACHE_HEADER_SIZE;
+		header.sourceSize = stamp->size;
+		header.sourceMtime = stamp->mtime;
+		header.contentHash = contentHash;
+		header.type = info.type;
+		header.width = info.width;
+		header.height = info.height;
+		header.maxVal = info.maxVal;
+		header.format = (int32_t)info.format;
+		header.nativeFormat = (int32_t)info.nativeFormat;
+		header.bitDepth = info.bitDepth;
+		header.colorType = info.colorType;
+		header.paletteSize = info.paletteSize;
+		memcpy(header.palette, info.palette, sizeof(header.palette));
+		header.stride = info.stride;
+		header.size = info.size;
+		memcpy(file.data, &header, sizeof(header));
+	}
+	unmapFile(&file);
+
+	if (!ok || !replaceFile(tempPath, cachePath))
+	{
+		remove(tempPath);
+		return 0;
+	}
+
+	return 1;
+}
+
+int openDiskCachedImage(const char* cacheDir, const char* path, const enum PixelFormat format,
+                        struct DiskCachedImage* out)
+{
+	if (!cacheDir || !path || !out) return 0;
+	memset(out, 0, sizeof(*out));
+
+	struct FileStamp stamp;
+	if (!getFileStamp(path, &stamp))
+	{
+		fprintf(stderr, "Failed to read file: %s\n", path);
+		return 0;
+	}
+
+	char cachePath[DISK_CACHE_PATH_MAX];
+	if (!getCachePath(cacheDir, path, format, cachePath, sizeof(cachePath)))
+	{
+		fprintf(stderr, "Failed to build cache path for: %s\n", path);
+		return 0;
+	}
+
+	if (loadCacheFile(cachePath, &stamp, NULL, format, out)) return 1;
+
+	struct MappedFile source;
+	if (!mapFile(path, &source))
+	{
+		fprintf(stderr, "Failed to read file: %s\n", path);
+		return 0;
+	}
+
+	const uint64_t contentHash = hashBytes(source.data, source.size, 0);
+	int ok = loadCacheFile(cachePath, &stamp, &contentHash, format, out);
+	if (!ok)
+		ok = writeCacheFile(cachePath, &stamp, contentHash, source.data, source.size, format) &&
+			loadCacheFile(cachePath, &stamp, NULL, format, out);
+	unmapFile(&source);
+
+	return ok;
+}
+
+void closeDiskCachedImage(struct DiskCachedImage* image)
+{
+	if (!image) return;
+
+	unmapFile(&image->file);
+	image->pixels = NULL;
+}
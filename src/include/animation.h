@@ -0,0 +1,28 @@
+#pragma once
+
+#include "parser.h"
+
+struct Animation;
+
+typedef void (*AnimationWake)(void);
+
+struct AnimationRect
+{
+	int x, y, width, height;
+};
+
+// Plays an APNG on a background thread that decodes each frame's region only and composites it into an RGBA8 canvas.
+// The next frame is decoded while the current one is on screen. `data` must stay valid until closeAnimation returns;
+// `wake` is called from the thread whenever a frame is ready.
+struct Animation* openAnimation(const unsigned char* data, size_t size, const struct ImageInfo* info,
+                                AnimationWake wake);
+void closeAnimation(struct Animation* animation);
+
+// The canvas format and size; frames are always composited to RGBA8
+const struct ImageInfo* getAnimationInfo(const struct Animation* animation);
+
+// Returns 1 when the next frame has been composited, with the canvas, the rectangle that changed since the previous
+// frame and how long the frame stays up. The canvas is not touched until unlockAnimationFrame. Returns 0 while the
+// frame is pending or the animation has finished playing, and -1 once a frame failed to decode.
+int lockAnimationFrame(struct Animation* animation, const void** canvas, struct AnimationRect* dirty, double* delay);
+void unlockAnimationFrame(struct Animation* animation);
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "parser.h"
+#include "platform.h"
+
+#define DEFAULT_DECODE_MEMORY ((size_t)4 << 30)
+#define DEFAULT_DECODE_DISK ((size_t)64 << 30)
+
+// Limits for a single decode, its output plus the decoder's scratch. A decode that needs more than `memory` bytes goes
+// out of core into temporary files in `spillDir` (the system temp directory when NULL); one that needs more than `disk`
+// bytes as well is refused at header time, before anything is allocated. A `disk` of 0 turns out-of-core decodes off.
+// Read by every getImageInfo call, so set it before any decoding threads start.
+void setDecodeBudget(size_t memory, size_t disk, const char* spillDir);
+// Called by setImageFormat once the output size is known, and again by callers that keep `extra` bytes derived from
+// the image next to it: sets `info->outOfCore`, or reports and returns 0 when the image is over budget
+int planDecode(struct ImageInfo* info, size_t extra);
+
+// Zero-filled heap memory for in-core decodes and a temporary file mapping for out-of-core ones
+struct DecodeBuffer
+{
+	void* data;
+	struct MappedFile file;
+};
+
+void* allocDecodeBuffer(size_t size, int outOfCore, struct DecodeBuffer* out);
+void freeDecodeBuffer(struct DecodeBuffer* buffer);
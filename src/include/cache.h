@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "parser.h"
+
+struct ImageCache;
+
+struct CachedImage
+{
+	struct ImageInfo info;
+	void* pixels;
+};
+
+struct ImageCacheStats
+{
+	size_t hits, misses, evictions, entries, bytes, budget;
+};
+
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed);
+
+struct ImageCache* createImageCache(size_t budget);
+void destroyImageCache(struct ImageCache* cache);
+
+// Returns the decoded image for `data`, decoding it on a miss with rows reported to `sink` (which may be NULL). A
+// decode the sink cancels returns NULL and is not cached. Pair every image with releaseImage.
+const struct CachedImage* acquireImage(struct ImageCache* cache, const unsigned char* data, size_t size,
+                                       enum PixelFormat format, const struct RowSink* sink);
+void releaseImage(struct ImageCache* cache, const struct CachedImage* image);
+void getImageCacheStats(struct ImageCache* cache, struct ImageCacheStats* out);
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <stddef.h>
+
+// Running checksums; a CRC-32 starts from 0 and an Adler-32 from 1
+unsigned int updateCRC32(unsigned int crc, const unsigned char* data, size_t size);
+unsigned int updateAdler32(unsigned int adler, const unsigned char* data, size_t size);
+// The Adler-32 of two buffers back to back, from their separate checksums and the length of the second
+unsigned int combineAdler32(unsigned int first, unsigned int second, size_t secondSize);
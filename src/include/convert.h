@@ -0,0 +1,50 @@
+#pragma once
+
+#include "parser.h"
+
+// Source row layouts; 16-bit samples are big-endian as stored in PNM and PNG. PBM1 rows use 1 = black, the packed
+// GRAY1/2/4 rows of PNG use 0 = black.
+enum RowLayout
+{
+	ROW_LAYOUT_PBM1 = 0,
+	ROW_LAYOUT_GRAY1,
+	ROW_LAYOUT_GRAY2,
+	ROW_LAYOUT_GRAY4,
+	ROW_LAYOUT_GRAY8,
+	ROW_LAYOUT_GRAY16,
+	ROW_LAYOUT_GRAYA8,
+	ROW_LAYOUT_GRAYA16,
+	ROW_LAYOUT_RGB8,
+	ROW_LAYOUT_RGB16,
+	ROW_LAYOUT_RGBA8,
+	ROW_LAYOUT_RGBA16,
+	ROW_LAYOUT_INDEX1,
+	ROW_LAYOUT_INDEX2,
+	ROW_LAYOUT_INDEX4,
+	ROW_LAYOUT_INDEX8,
+	ROW_LAYOUT_COUNT
+};
+
+struct RowContext
+{
+	int y;
+	const unsigned char (*palette)[4];
+	float scale;
+	const void *lut, *alphaLut;
+};
+
+typedef void (*RowConverter)(const unsigned char* src, void* dst, int width, const struct RowContext* ctx);
+
+struct RowConversion
+{
+	RowConverter convert;
+	struct RowContext ctx;
+	void* owned[2];
+};
+
+size_t getRowLayoutBytes(enum RowLayout layout, int width);
+// `gamma` is the file gamma of the samples (PNG gAMA); 0 means they are already encoded for display
+int initRowConversion(struct RowConversion* out, enum RowLayout layout, enum PixelFormat format, unsigned int maxVal,
+                      float gamma);
+void freeRowConversion(struct RowConversion* conversion);
+int applyPaletteTransfer(unsigned char (*palette)[4], int count, float gamma);
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <stddef.h>
+
+// Compresses `src` into a zlib stream in `*out`, which the caller frees. The input is cut into chunks that `threads`
+// workers deflate independently, each primed with the 32 KiB before it as its dictionary, so the output stays one
+// ordinary stream while throughput scales with cores.
+int deflateZlib(const unsigned char* src, size_t size, int threads, unsigned char** out, size_t* outSize);
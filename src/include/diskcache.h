@@ -0,0 +1,14 @@
+#pragma once
+
+#include "parser.h"
+#include "platform.h"
+
+struct DiskCachedImage
+{
+	struct ImageInfo info;
+	void* pixels;
+	struct MappedFile file;
+};
+
+int openDiskCachedImage(const char* cacheDir, const char* path, enum PixelFormat format, struct DiskCachedImage* out);
+void closeDiskCachedImage(struct DiskCachedImage* image);
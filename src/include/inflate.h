@@ -0,0 +1,12 @@
+#pragma once
+
+#include <stddef.h>
+
+// Called after each deflate block with the number of bytes produced so far; returning 0 stops inflating
+typedef int (*InflateProgress)(void* user, size_t produced);
+
+int inflateZlib(const unsigned char* src, size_t srcSize, unsigned char* dst, size_t dstSize, size_t* outSize);
+// With `verify` set the stream must end in an Adler-32 matching the output, which is checksummed block by block as it
+// is produced
+int inflateZlibProgressive(const unsigned char* src, size_t srcSize, unsigned char* dst, size_t dstSize,
+                           size_t* outSize, int verify, InflateProgress progress, void* user);
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "parser.h"
+#include "uploadring.h"
+
+struct ImageLoad;
+
+typedef void (*ImageLoadWake)(void);
+
+// Decodes into `dst` on a background thread. `data` and `dst` must stay valid until finishImageLoad returns. `wake`,
+// when set, is called from the decoder thread whenever rows become pending after a drain and once the decode ends,
+// so the caller can sleep between updates. With a `ring` the decoder thread copies finished rows into its slots itself
+// and the lockLoadedRows pair reports nothing.
+struct ImageLoad* startImageLoad(const unsigned char* data, size_t size, const struct ImageInfo* info, void* dst,
+                                 size_t stride, ImageLoadWake wake, struct UploadRing* ring);
+// Locks the destination and reports the rows published since the last call; always pair with unlockLoadedRows
+int lockLoadedRows(struct ImageLoad* load, int* y, int* count);
+void unlockLoadedRows(struct ImageLoad* load);
+int isImageLoadDone(struct ImageLoad* load);
+// Cancels the decode if it is still running, waits for the thread and returns whether the image decoded completely
+int finishImageLoad(struct ImageLoad* load, int cancel);
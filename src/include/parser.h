@@ -1,5 +1,7 @@
 #pragma once
 
+#include <stddef.h>
+
 enum ImageType
 {
 	IMAGE_TYPE_UNKNOWN = 0,
@@ -22,23 +24,86 @@ enum ImageType
 	IMAGE_TYPE_JPEG_BASELINE
 };
 
+// 16-bit formats hold unsigned shorts in host byte order
+enum PixelFormat
+{
+	PIXEL_FORMAT_NATIVE = -1, // resolved to ImageInfo.nativeFormat by getImageInfo
+	PIXEL_FORMAT_POINT = 0, // struct Pixel, ready to be drawn as a point sprite
+	PIXEL_FORMAT_RGB8,
+	PIXEL_FORMAT_RGBA8,
+	PIXEL_FORMAT_RGBA32F,
+	PIXEL_FORMAT_INDEX8, // one palette index per byte, expanded through ImageInfo.palette
+	PIXEL_FORMAT_GRAY8,
+	PIXEL_FORMAT_GRAY16,
+	PIXEL_FORMAT_RGB16,
+	PIXEL_FORMAT_RGBA16,
+	PIXEL_FORMAT_COUNT
+};
+
+// How much of a file's integrity data a decode checks. PNG chunk CRCs are verified for every chunk, for critical chunks
+// only (IHDR, PLTE, IDAT) or not at all; the zlib Adler-32 is verified unless checks are off.
+enum ChecksumPolicy
+{
+	CHECKSUM_FULL = 0,
+	CHECKSUM_CRITICAL,
+	CHECKSUM_NONE
+};
+
+// Filled in by getImageInfo from the header alone, before any pixel data is touched. `stride` and `size` describe the
+// buffer parseImageInto needs for `format`; `nativeFormat` is the smallest format that keeps every sample exact. The
+// remaining fields are decoder state carried over from the header.
+struct ImageInfo
+{
+	int type, width, height, maxVal, bitDepth, colorType, interlace;
+	enum PixelFormat format, nativeFormat;
+	size_t stride, size, dataOffset;
+	float gamma; // file gamma still to be corrected for display, 0 when the samples are already sRGB
+	int paletteSize, hasColorKey;
+	unsigned short colorKey[3];
+	unsigned char palette[256][4];
+	int frameCount, loopCount; // APNG acTL, frameCount is 0 for still images and loopCount 0 loops forever
+	enum ChecksumPolicy checksums; // the default policy when getImageInfo ran; may be changed before decoding
+	size_t scratchSize; // working memory the decoder needs on top of the output
+	int outOfCore; // over the memory budget: the output and the decoder's scratch belong in DecodeBuffer file mappings
+};
+
+// Receives rows as a progressive decode makes them visible. The decoder writes rows [y, y + count) of the destination
+// between beginRows and endRows, both called on the decoding thread; endRows returning 0 cancels the decode.
+struct RowSink
+{
+	void (*beginRows)(void* user);
+	int (*endRows)(void* user, int y, int count);
+	void* user;
+};
+
+size_t getPixelFormatSize(enum PixelFormat format);
+// Applies to every getImageInfo call made afterwards, so set it before any decoding threads start
+void setDefaultChecksumPolicy(enum ChecksumPolicy policy);
+int getImageInfo(const unsigned char* data, size_t size, enum PixelFormat format, struct ImageInfo* info);
+int setImageFormat(struct ImageInfo* info, enum PixelFormat format);
+int parseImageInto(const unsigned char* data, size_t size, const struct ImageInfo* info, void* dst, size_t stride);
+int parseImageProgressive(const unsigned char* data, size_t size, const struct ImageInfo* info, void* dst,
+                          size_t stride, const struct RowSink* sink);
+int isProgressiveImage(const struct ImageInfo* info);
+int isAnimatedImage(const struct ImageInfo* info);
+
 struct Pixel* parseImage(const unsigned char* data, size_t size, size_t* count, int* width, int* height);
 int getImageType(const unsigned char* data, size_t size);
 
-struct Pixel* parsePPM_P3(const unsigned char* data, size_t size, size_t* count, int* width, int* height);
-struct Pixel* parsePPM_P6(const unsigned char* data, size_t size, size_t* count, int* width, int* height);
-struct Pixel* parsePGM_P5(const unsigned char* data, size_t size, size_t* count, int* width, int* height);
-struct Pixel* parsePBM_P4(const unsigned char* data, size_t size, size_t* count, int* width, int* height);
-struct Pixel* parseBMP_24(const unsigned char* data, size_t size, size_t* count, int* width, int* height);
-struct Pixel* parseBMP_32(const unsigned char* data, size_t size, size_t* count, int* width, int* height);
-struct Pixel* parseTGA_24(const unsigned char* data, size_t size, size_t* count, int* width, int* height);
-struct Pixel* parseTGA_32(const unsigned char* data, size_t size, size_t* count, int* width, int* height);
-struct Pixel* parseTGA_RLE(const unsigned char* data, size_t size, size_t* count, int* width, int* height);
-struct Pixel* parsePNG_8bit(const unsigned char* data, size_t size, size_t* count, int* width, int* height);
-struct Pixel* parsePNG_TRNS(const unsigned char* data, size_t size, size_t* count, int* width, int* height);
-struct Pixel* parsePNG_PLTE(const unsigned char* data, size_t size, size_t* count, int* width, int* height);
-struct Pixel* parsePNG_Grayscale(const unsigned char* data, size_t size, size_t* count, int* width, int* height);
-struct Pixel* parsePNG_16bit(const unsigned char* data, size_t size, size_t* count, int* width, int* height);
-struct Pixel* parsePNG_ADAM7(const unsigned char* data, size_t size, size_t* count, int* width, int* height);
-struct Pixel* parseTIFF_Baseline(const unsigned char* data, size_t size, size_t* count, int* width, int* height);
-struct Pixel* parseJPEG_Baseline(const unsigned char* data, size_t size, size_t* count, int* width, int* height);
+int parsePPM_P3(const unsigned char* data, size_t size, const struct ImageInfo* info, void* dst, size_t stride);
+int parsePPM_P6(const unsigned char* data, size_t size, const struct ImageInfo* info, void* dst, size_t stride);
+int parsePGM_P5(const unsigned char* data, size_t size, const struct ImageInfo* info, void* dst, size_t stride);
+int parsePBM_P4(const unsigned char* data, size_t size, const struct ImageInfo* info, void* dst, size_t stride);
+int parseBMP_24(const unsigned char* data, size_t size, const struct ImageInfo* info, void* dst, size_t stride);
+int parseBMP_32(const unsigned char* data, size_t size, const struct ImageInfo* info, void* dst, size_t stride);
+int parseTGA_24(const unsigned char* data, size_t size, const struct ImageInfo* info, void* dst, size_t stride);
+int parseTGA_32(const unsigned char* data, size_t size, const struct ImageInfo* info, void* dst, size_t stride);
+int parseTGA_RLE(const unsigned char* data, size_t size, const struct ImageInfo* info, void* dst, size_t stride);
+int parsePNG_8bit(const unsigned char* data, size_t size, const struct ImageInfo* info, void* dst, size_t stride);
+int parsePNG_TRNS(const unsigned char* data, size_t size, const struct ImageInfo* info, void* dst, size_t stride);
+int parsePNG_PLTE(const unsigned char* data, size_t size, const struct ImageInfo* info, void* dst, size_t stride);
+int parsePNG_Grayscale(const unsigned char* data, size_t size, const struct ImageInfo* info, void* dst, size_t stride);
+int parsePNG_16bit(const unsigned char* data, size_t size, const struct ImageInfo* info, void* dst, size_t stride);
+int parsePNG_ADAM7(const unsigned char* data, size_t size, const struct ImageInfo* info, void* dst, size_t stride);
+int parseTIFF_Baseline(const unsigned char* data, size_t size, const struct ImageInfo* info, void* dst, size_t stride);
+int parseJPEG_Baseline(const unsigned char* data, size_t size, const struct ImageInfo* info, void* dst, size_t stride);
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stddef.h>
+
+struct MappedFile
+{
+	void* data;
+	size_t size;
+#ifdef _WIN32
+	void *file, *mapping;
+#endif
+};
+
+struct FileStamp
+{
+	long long mtime;
+	unsigned long long size;
+};
+
+int mapFile(const char* path, struct MappedFile* out);
+int createMappedFile(const char* path, size_t size, struct MappedFile* out);
+// Scratch space backed by a file in `dir` (the system temp directory when NULL), deleted as soon as it is unmapped
+int createTempMappedFile(const char* dir, size_t size, struct MappedFile* out);
+void unmapFile(struct MappedFile* file);
+
+int getFileStamp(const char* path, struct FileStamp* out);
+int getAbsolutePath(const char* path, char* out, size_t outSize);
+int replaceFile(const char* from, const char* to);
+unsigned long getProcessId(void);
+int getProcessorCount(void);
+// Seconds on a monotonic clock
+double getTime(void);
+
+int isDirectory(const char* path);
+// Expands a directory (its regular files) or a wildcard pattern into paths; free them with freeFileList
+int listFiles(const char* pattern, char*** out, int* count);
+void freeFileList(char** paths, int count);
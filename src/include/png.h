@@ -0,0 +1,36 @@
+#pragma once
+
+#include "parser.h"
+
+enum PNGDispose
+{
+	PNG_DISPOSE_NONE = 0,
+	PNG_DISPOSE_BACKGROUND,
+	PNG_DISPOSE_PREVIOUS
+};
+
+enum PNGBlend
+{
+	PNG_BLEND_SOURCE = 0,
+	PNG_BLEND_OVER
+};
+
+// One APNG frame: its region of the canvas, how long it stays up and what happens to the region afterwards
+struct PNGFrame
+{
+	int x, y, width, height;
+	double delay; // seconds
+	int dispose, blend;
+	size_t dataOffset;
+};
+
+int readPNGHeader(const unsigned char* data, size_t size, struct ImageInfo* info);
+// What decodePNG allocates besides the output, SIZE_MAX when the image is too large to decode at all
+size_t getPNGScratchSize(const struct ImageInfo* info);
+int decodePNG(const unsigned char* data, size_t size, const struct ImageInfo* info, void* dst, size_t stride,
+              const struct RowSink* sink);
+// Fills `info->frameCount` frames from the fcTL chunks of an APNG
+int readPNGFrames(const unsigned char* data, size_t size, const struct ImageInfo* info, struct PNGFrame* frames);
+// Decodes only the frame's region; `dst` holds frame->width x frame->height pixels in info->format
+int decodePNGFrame(const unsigned char* data, size_t size, const struct ImageInfo* info, const struct PNGFrame* frame,
+                   void* dst, size_t stride, const struct RowSink* sink);
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "budget.h"
+#include "parser.h"
+
+#define TILE_SIZE 256
+#define PYRAMID_MAX_LEVELS 32
+
+struct PyramidLevel
+{
+	int width, height, tilesX, tilesY;
+	size_t stride;
+	const unsigned char* pixels;
+};
+
+// Level 0 borrows the decoded image; every further level halves both sides with a 2x2 box filter until the whole image
+// fits in a single TILE_SIZE tile. The levels are allocated like the image, in a temporary file when it is out of core.
+struct Pyramid
+{
+	struct ImageInfo info;
+	int levelCount;
+	struct PyramidLevel levels[PYRAMID_MAX_LEVELS];
+	struct DecodeBuffer buffers[PYRAMID_MAX_LEVELS];
+};
+
+int canBuildPyramid(enum PixelFormat format);
+// Bytes buildPyramid allocates for every level below the image itself
+size_t getPyramidSize(const struct ImageInfo* info);
+// `pixels` must hold the image described by `info` and outlive the pyramid; it is not freed by destroyPyramid
+int buildPyramid(struct Pyramid* out, const struct ImageInfo* info, const void* pixels);
+void destroyPyramid(struct Pyramid* pyramid);
@@ -3,9 +3,19 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
+#include "parser.h"
+#include "pyramid.h"
+#include "uploadring.h"
+#include "view.h"
+
+struct TileCache;
+
 struct GLObjects
 {
 	GLuint VAO, VBO, program;
+	GLuint texture, palette, PBO;
+	struct TileCache* tiles;
+	struct UploadRing* uploads;
 };
 
 struct Pixel
@@ -13,14 +23,52 @@ struct Pixel
 	float x, y, r, g, b, a, size;
 };
 
+// Render loop counters; times are in seconds from the start of a redraw to the return of the buffer swap
+struct FrameStats
+{
+	unsigned long long frames, wakeups;
+	double lastFrameTime, maxFrameTime, totalFrameTime;
+};
+
 #define PADDING 8
 #define PIXEL_SIZE 1
+// Images that do not fit in a window this large are shown through the tiled pyramid instead of a single texture
+#define MAX_WINDOW_WIDTH 1600
+#define MAX_WINDOW_HEIGHT 1000
 
 GLFWwindow* createWindow(int w, int h, const char* title);
 int initGLEW();
 void setUniform3f(GLuint program, const char* name, float x, float y, float z);
 void updatePositions(int fbW, int fbH);
+void invalidateFrame(void);
+// Returns whether the frame was invalidated since the last redraw and, if so, starts timing a new one
+int beginFrame(void);
+void endFrame(GLFWwindow* window);
+// Sleeps until an event arrives, or only drains pending events when `poll` is set
+void waitForEvents(int poll);
+// Sleeps until an event arrives or `timeout` seconds have passed
+void waitForEventsTimeout(double timeout);
+const struct FrameStats* getFrameStats(void);
 
 int createObjects(struct GLObjects* out, const struct Pixel* pixelObjects, size_t totalCount);
+struct Pixel* mapObjects(const struct GLObjects* glObjects, size_t totalCount);
+int unmapObjects(const struct GLObjects* glObjects);
+int createTextureObjects(struct GLObjects* out, const struct ImageInfo* info, const void* pixels);
+int updateTextureRows(const struct GLObjects* glObjects, const struct ImageInfo* info, const void* pixels, int y,
+                      int count);
+// Uploads only the given rectangle of `pixels`, which holds the whole image
+int updateTextureRect(const struct GLObjects* glObjects, const struct ImageInfo* info, const void* pixels, int x, int y,
+                      int width, int height);
+// Creates glObjects->uploads for streaming rows of `info` into the texture from another thread
+struct UploadRing* createUploadRing(struct GLObjects* glObjects, const struct ImageInfo* info);
+// Uploads the slots the producer has submitted and recycles those the GPU is done with; returns whether transfers
+// are still in flight
+int flushUploadRing(struct GLObjects* glObjects, const struct ImageInfo* info);
+void destroyUploadRing(struct GLObjects* glObjects);
+void* mapTextureObjects(struct GLObjects* glObjects, const struct ImageInfo* info);
+int unmapTextureObjects(struct GLObjects* glObjects, const struct ImageInfo* info);
+int createTileObjects(struct GLObjects* out, const struct Pyramid* pyramid);
 void destroyObjects(struct GLObjects* glObjects);
 void render(const struct GLObjects* glObjects, GLsizei totalCount);
+// Returns the number of visible tiles that are not resident yet, drawn from a coarser level in the meantime
+int renderTiles(const struct GLObjects* glObjects, const struct Pyramid* pyramid, const struct View* view);
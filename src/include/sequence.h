@@ -0,0 +1,28 @@
+#pragma once
+
+#include "cache.h"
+#include "parser.h"
+
+#define SEQUENCE_MAX_THREADS 4
+
+struct Sequence;
+
+typedef void (*SequenceWake)(void);
+
+// Images of a directory or glob, decoded ahead of and behind a cursor on worker threads. At most `budget` bytes of
+// decoded pixels are held in the window; the cursor's own image is always decoded, even over budget. Decodes go through
+// `cache`, which must outlive the sequence: images that leave the window are released to it, so it keeps them for a
+// revisit as long as its own budget allows. `wake` is called from a worker whenever an image finishes.
+struct Sequence* openSequence(const char* pattern, int ahead, int behind, size_t budget, struct ImageCache* cache,
+                              SequenceWake wake);
+void closeSequence(struct Sequence* sequence);
+
+int getSequenceLength(const struct Sequence* sequence);
+const char* getSequencePath(const struct Sequence* sequence, int index);
+// Moves the prefetch window; decodes that fall out of it are cancelled
+void setSequenceCursor(struct Sequence* sequence, int index);
+
+// Returns 1 and pins the image while it is decoded, 0 while it is pending and -1 when it failed to decode. A pinned
+// image is never evicted; release it with unlockSequenceImage.
+int lockSequenceImage(struct Sequence* sequence, int index, struct ImageInfo* info, const void** pixels);
+void unlockSequenceImage(struct Sequence* sequence, int index);
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "parser.h"
+#include "renderer.h"
+
+// CPU counterpart of the OpenGL backend for hosts without a GPU or display. The image is composited into an RGBA8
+// framebuffer with the same placement and SRC_ALPHA/ONE_MINUS_SRC_ALPHA blending as the GL path. Unlike the GL
+// objects, the pixels are borrowed and must stay valid while the objects are rendered.
+struct SoftObjects
+{
+	int width, height, threadCount;
+	unsigned char *frame, *scratch;
+	unsigned char clear[4];
+
+	const struct Pixel* points;
+	size_t pointCount;
+	struct ImageInfo info;
+	const void* pixels;
+	int opaque;
+};
+
+int createSoftObjects(struct SoftObjects* out, const struct Pixel* pixelObjects, size_t totalCount);
+int createSoftTextureObjects(struct SoftObjects* out, const struct ImageInfo* info, const void* pixels);
+int updateSoftPositions(struct SoftObjects* softObjects, int fbW, int fbH);
+void setSoftClearColor(struct SoftObjects* softObjects, float r, float g, float b, float a);
+void destroySoftObjects(struct SoftObjects* softObjects);
+int renderSoft(struct SoftObjects* softObjects);
+int writeSoftFramePPM(const struct SoftObjects* softObjects, const char* path);
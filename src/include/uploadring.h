@@ -0,0 +1,51 @@
+#pragma once
+
+#include <pthread.h>
+#include <stddef.h>
+
+#define UPLOAD_RING_SLOTS 4
+#define UPLOAD_SLOT_BYTES ((size_t)4 << 20)
+
+enum UploadSlotState
+{
+	UPLOAD_SLOT_FREE = 0,
+	UPLOAD_SLOT_READY,
+	UPLOAD_SLOT_IN_FLIGHT
+};
+
+struct UploadSlot
+{
+	unsigned char* data;
+	size_t offset;
+	int y, count;
+	enum UploadSlotState state;
+	void* fence; // owned by the consumer while the slot is in flight
+};
+
+// Hands rows from a decoder thread to the GL thread through a fixed ring of slots of `slotRows` rows each. The
+// producer fills slots in order and blocks while the next one is still queued or being read by the GPU; the consumer
+// takes ready slots in the same order and frees each once its transfer has completed. This part is GL-free: the
+// renderer supplies the slot memory, a persistently mapped pixel buffer when it can.
+struct UploadRing
+{
+	pthread_mutex_t lock;
+	pthread_cond_t freed;
+	struct UploadSlot slots[UPLOAD_RING_SLOTS];
+	size_t stride;
+	int slotRows, head, tail, closed;
+	unsigned int buffer; // pixel unpack buffer holding the slots, 0 when they live in client memory
+	unsigned char* memory;
+};
+
+int initUploadRing(struct UploadRing* ring, unsigned char* memory, unsigned int buffer, size_t stride, int slotRows);
+void freeUploadRing(struct UploadRing* ring);
+
+// Producer side. acquireUploadSlot returns NULL once the ring is closed.
+int isUploadRingIdle(struct UploadRing* ring);
+unsigned char* acquireUploadSlot(struct UploadRing* ring);
+void submitUploadSlot(struct UploadRing* ring, int y, int count);
+void closeUploadRing(struct UploadRing* ring);
+
+// Consumer side
+struct UploadSlot* takeReadySlot(struct UploadRing* ring);
+void releaseUploadSlot(struct UploadRing* ring, struct UploadSlot* slot);
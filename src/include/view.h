@@ -0,0 +1,21 @@
+#pragma once
+
+#include <GLFW/glfw3.h>
+
+// Zoom and pan state of the tiled viewer. The image pixel (centerX, centerY) is shown at the middle of the
+// framebuffer and `zoom` is framebuffer pixels per image pixel.
+struct View
+{
+	double centerX, centerY, zoom, minZoom, maxZoom;
+	int imageWidth, imageHeight, viewWidth, viewHeight;
+	int dragging, dirty;
+	double dragX, dragY;
+};
+
+void initView(struct View* view, int imageWidth, int imageHeight, int viewWidth, int viewHeight);
+void resizeView(struct View* view, int viewWidth, int viewHeight);
+void fitView(struct View* view);
+// `anchorX`/`anchorY` is the framebuffer position that stays put while zooming
+void zoomView(struct View* view, double factor, double anchorX, double anchorY);
+void panView(struct View* view, double dx, double dy);
+void attachViewControls(GLFWwindow* window, struct View* view);
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "parser.h"
+
+// Binary PGM for the gray formats and PPM for the rest; alpha is dropped and palettes are expanded
+int writePNM(const char* path, const struct ImageInfo* info, const void* pixels, size_t stride);
+// Each row gets the filter with the smallest sum of absolute differences, and rows are filtered and deflated on
+// `threads` workers
+int writePNG(const char* path, const struct ImageInfo* info, const void* pixels, size_t stride, int threads);
+// Picks the encoder from the extension: PNG for ".png", PNM for anything else
+int writeImage(const char* path, const struct ImageInfo* info, const void* pixels, size_t stride, int threads);
@@ -0,0 +1,359 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "./include/checksum.h"
+#include "./include/inflate.h"
+
+#define INFLATE_FAST_BITS 9
+#define INFLATE_FAST_MASK ((1 << INFLATE_FAST_BITS) - 1)
+
+struct Huffman
+{
+	uint16_t fast[1 << INFLATE_FAST_BITS];
+	uint16_t firstCode[16], firstSymbol[16];
+	int maxCode[17];
+	uint8_t size[288];
+	uint16_t value[288];
+};
+
+struct Inflater
+{
+	const unsigned char *src, *srcEnd;
+	unsigned char *dst, *out, *dstEnd;
+	uint64_t bits;
+	int bitCount;
+	size_t padding;
+	struct Huffman litLen, dist;
+};
+
+static const uint16_t lengthBase[31] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258, 0,
+	0
+};
+static const uint8_t lengthExtra[31] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0, 0, 0
+};
+static const uint16_t distBase[32] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+	8193, 12289, 16385, 24577, 0, 0
+};
+static const uint8_t distExtra[32] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13, 0, 0
+};
+static const uint8_t codeLengthOrder[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+static int reverseBits(int v, const int bits)
+{
+	v = (v & 0xAAAA) >> 1 | (v & 0x5555) << 1;
+	v = (v & 0xCCCC) >> 2 | (v & 0x3333) << 2;
+	v = (v & 0xF0F0) >> 4 | (v & 0x0F0F) << 4;
+	v = (v & 0xFF00) >> 8 | (v & 0x00FF) << 8;
+
+	return v >> (16 - bits);
+}
+
+static int buildHuffman(struct Huffman* h, const uint8_t* lengths, const int count)
+{
+	int sizes[17] = {0}, nextCode[16];
+	memset(h->fast, 0, sizeof(h->fast));
+
+	for (int i = 0; i < count; ++i) sizes[lengths[i]]++;
+	sizes[0] = 0;
+	for (int i = 1; i < 16; ++i)
+		if (sizes[i] > 1 << i) return 0;
+
+	int code = 0, k = 0;
+	for (int i = 1; i < 16; ++i)
+	{
+		nextCode[i] = code;
+		h->firstCode[i] = (uint16_t)code;
+		h->firstSymbol[i] = (uint16_t)k;
+
+		code += sizes[i];
+		if (sizes[i] && code - 1 >= 1 << i) return 0;
+
+		h->maxCode[i] = code << (16 - i);
+		code <<= 1;
+		k += sizes[i];
+	}
+	h->maxCode[16] = 0x10000;
+
+	for (int i = 0; i < count; ++i)
+	{
+		const int s = lengths[i];
+		if (!s) continue;
+
+		const int c = nextCode[s] - h->firstCode[s] + h->firstSymbol[s];
+		h->size[c] = (uint8_t)s;
+		h->value[c] = (uint16_t)i;
+
+		if (s <= INFLATE_FAST_BITS)
+			for (int j = reverseBits(nextCode[s], s); j < 1 << INFLATE_FAST_BITS; j += 1 << s)
+				h->fast[j] = (uint16_t)(s << 9 | i);
+
+		nextCode[s]++;
+	}
+
+	return 1;
+}
+
+static void refill(struct Inflater* z)
+{
+	while (z->bitCount <= 56)
+	{
+		uint64_t byte = 0;
+		if (z->src < z->srcEnd) byte = *z->src++;
+		else z->padding++;
+
+		z->bits |= byte << z->bitCount;
+		z->bitCount += 8;
+	}
+}
+
+static unsigned int readBits(struct Inflater* z, const int n)
+{
+	if (z->bitCount < n) refill(z);
+
+	const unsigned int v = (unsigned int)(z->bits & ((1ull << n) - 1));
+	z->bits >>= n;
+	z->bitCount -= n;
+
+	return v;
+}
+
+static int decodeSymbol(struct Inflater* z, const struct Huffman* h)
+{
+	if (z->bitCount < 16) refill(z);
+
+	const int fast = h->fast[z->bits & INFLATE_FAST_MASK];
+	if (fast)
+	{
+		const int s = fast >> 9;
+		z->bits >>= s;
+		z->bitCount -= s;
+
+		return fast & 511;
+	}
+
+	const int k = reverseBits((int)(z->bits & 0xFFFF), 16);
+	int s = INFLATE_FAST_BITS + 1;
+	while (k >= h->maxCode[s]) s++;
+	if (s >= 16) return -1;
+
+	const int b = (k >> (16 - s)) - h->firstCode[s] + h->firstSymbol[s];
+	if (b >= 288 || h->size[b] != s) return -1;
+
+	z->bits >>= s;
+	z->bitCount -= s;
+
+	return h->value[b];
+}
+
+static int inflateStored(struct Inflater* z)
+{
+	readBits(z, z->bitCount & 7);
+
+	unsigned char header[4];
+	for (int i = 0; i < 4; ++i) header[i] = (unsigned char)readBits(z, 8);
+
+	const unsigned int len = (unsigned int)(header[0] | header[1] << 8),
+	                   nlen = (unsigned int)(header[2] | header[3] << 8);
+	if (len != (~nlen & 0xFFFF))
+	{
+		fprintf(stderr, "Corrupt deflate stream: stored block length mismatch\n");
+		return 0;
+	}
+	if ((size_t)(z->dstEnd - z->out) < len)
+	{
+		fprintf(stderr, "Corrupt deflate stream: output overflow\n");
+		return 0;
+	}
+
+	// The length fields themselves ran past the input if they took bytes from the zero padding
+	if (z->padding > (size_t)z->bitCount / 8)
+	{
+		fprintf(stderr, "Corrupt deflate stream: truncated stored block\n");
+		return 0;
+	}
+
+	// Hand the whole bytes still sitting in the bit buffer back to the input (minus any zero padding it was topped
+	// up with) so the block can be copied with a single memcpy.
+	z->src -= (size_t)(z->bitCount / 8) - z->padding;
+	z->padding = 0;
+	z->bits = 0;
+	z->bitCount = 0;
+
+	if ((size_t)(z->srcEnd - z->src) < len)
+	{
+		fprintf(stderr, "Corrupt deflate stream: truncated stored block\n");
+		return 0;
+	}
+
+	memcpy(z->out, z->src, len);
+	z->out += len;
+	z->src += len;
+
+	return 1;
+}
+
+static int inflateDynamicTables(struct Inflater* z)
+{
+	const int hlit = (int)readBits(z, 5) + 257, hdist = (int)readBits(z, 5) + 1, hclen = (int)readBits(z, 4) + 4;
+	uint8_t codeLengths[19] = {0}, lengths[286 + 32];
+	struct Huffman codeLengthHuffman;
+
+	if (hlit > 286 || hdist > 30)
+	{
+		fprintf(stderr, "Corrupt deflate stream: too many literal or distance codes\n");
+		return 0;
+	}
+
+	for (int i = 0; i < hclen; ++i) codeLengths[codeLengthOrder[i]] = (uint8_t)readBits(z, 3);
+	if (!buildHuffman(&codeLengthHuffman, codeLengths, 19)) return 0;
+
+	int n = 0;
+	while (n < hlit + hdist)
+	{
+		const int sym = decodeSymbol(z, &codeLengthHuffman);
+		if (sym < 0) return 0;
+
+		if (sym < 16)
+		{
+			lengths[n++] = (uint8_t)sym;
+			continue;
+		}
+
+		int repeat;
+		uint8_t fill = 0;
+		if (sym == 16)
+		{
+			if (n == 0) return 0;
+			repeat = 3 + (int)readBits(z, 2);
+			fill = lengths[n - 1];
+		}
+		else if (sym == 17) repeat = 3 + (int)readBits(z, 3);
+		else repeat = 11 + (int)readBits(z, 7);
+
+		if (n + repeat > hlit + hdist) return 0;
+		memset(lengths + n, fill, (size_t)repeat);
+		n += repeat;
+	}
+
+	return buildHuffman(&z->litLen, lengths, hlit) && buildHuffman(&z->dist, lengths + hlit, hdist);
+}
+
+static int inflateFixedTables(struct Inflater* z)
+{
+	uint8_t lengths[288 + 32];
+	memset(lengths, 8, 144);
+	memset(lengths + 144, 9, 112);
+	memset(lengths + 256, 7, 24);
+	memset(lengths + 280, 8, 8);
+	memset(lengths + 288, 5, 32);
+
+	return buildHuffman(&z->litLen, lengths, 288) && buildHuffman(&z->dist, lengths + 288, 32);
+}
+
+static int inflateCompressed(struct Inflater* z)
+{
+	for (;;)
+	{
+		int sym = decodeSymbol(z, &z->litLen);
+		if (sym < 256)
+		{
+			if (sym < 0 || z->out >= z->dstEnd) return 0;
+			*z->out++ = (unsigned char)sym;
+			continue;
+		}
+		if (sym == 256) return 1;
+
+		sym -= 257;
+		if (sym >= 29) return 0;
+		const size_t len = lengthBase[sym] + readBits(z, lengthExtra[sym]);
+
+		const int ds = decodeSymbol(z, &z->dist);
+		if (ds < 0 || ds >= 30) return 0;
+		const size_t dist = distBase[ds] + readBits(z, distExtra[ds]);
+
+		if ((size_t)(z->out - z->dst) < dist || (size_t)(z->dstEnd - z->out) < len) return 0;
+
+		const unsigned char* from = z->out - dist;
+		if (dist == 1) memset(z->out, *from, len);
+		else if (dist >= len) memcpy(z->out, from, len);
+		else
+			for (size_t i = 0; i < len; ++i) z->out[i] = from[i];
+		z->out += len;
+	}
+}
+
+int inflateZlib(const unsigned char* src, const size_t srcSize, unsigned char* dst, const size_t dstSize,
+                size_t* outSize)
+{
+	return inflateZlibProgressive(src, srcSize, dst, dstSize, outSize, 1, NULL, NULL);
+}
+
+int inflateZlibProgressive(const unsigned char* src, const size_t srcSize, unsigned char* dst, const size_t dstSize,
+                           size_t* outSize, const int verify, const InflateProgress progress, void* user)
+{
+	if (!src || !dst || srcSize < 2) return 0;
+
+	const unsigned int cmf = src[0], flg = src[1];
+	if ((cmf & 15) != 8 || cmf >> 4 > 7 || (cmf << 8 | flg) % 31 != 0 || flg & 32)
+	{
+		fprintf(stderr, "Invalid zlib header\n");
+		return 0;
+	}
+
+	struct Inflater z;
+	memset(&z, 0, sizeof(z));
+	z.src = src + 2;
+	z.srcEnd = src + srcSize;
+	z.dst = z.out = dst;
+	z.dstEnd = dst + dstSize;
+
+	unsigned int adler = 1;
+	int last;
+	do
+	{
+		unsigned char* const blockStart = z.out;
+		last = (int)readBits(&z, 1);
+		const unsigned int type = readBits(&z, 2);
+
+		int ok;
+		if (type == 0) ok = inflateStored(&z);
+		else if (type == 1) ok = inflateFixedTables(&z) && inflateCompressed(&z);
+		else if (type == 2) ok = inflateDynamicTables(&z) && inflateCompressed(&z);
+		else ok = 0;
+
+		if (!ok || z.padding * 8 > (size_t)z.bitCount)
+		{
+			fprintf(stderr, "Corrupt deflate stream\n");
+			return 0;
+		}
+		// Checksum each block's output right after it is written, while it is still in cache
+		if (verify) adler = updateAdler32(adler, blockStart, (size_t)(z.out - blockStart));
+		if (progress && !progress(user, (size_t)(z.out - z.dst))) return 0;
+	}
+	while (!last);
+
+	if (verify)
+	{
+		readBits(&z, z.bitCount & 7);
+		unsigned int stored = 0;
+		for (int i = 0; i < 4; ++i) stored = stored << 8 | readBits(&z, 8);
+		if (z.padding * 8 > (size_t)z.bitCount)
+		{
+			fprintf(stderr, "Truncated zlib stream: missing Adler-32 checksum\n");
+			return 0;
+		}
+		if (stored != adler)
+		{
+			fprintf(stderr, "Corrupt zlib stream: Adler-32 is %08X, expected %08X\n", adler, stored);
+			return 0;
+		}
+	}
+
+	if (outSize) *outSize = (size_t)(z.out - z.dst);
+	return 1;
+}
@@ -0,0 +1,171 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "./include/loader.h"
+
+struct ImageLoad
+{
+	const unsigned char* data;
+	size_t size, stride;
+	struct ImageInfo info;
+	void* dst;
+	ImageLoadWake wake;
+	struct UploadRing* ring;
+
+	pthread_t thread;
+	pthread_mutex_t lock;
+	int dirtyBegin, dirtyEnd, result;
+	int ringBegin, ringEnd; // rows not yet copied into the ring, touched by the decoder thread only
+	atomic_int done, cancel;
+};
+
+static void beginRows(void* user)
+{
+	struct ImageLoad* load = user;
+	pthread_mutex_lock(&load->lock);
+}
+
+// Grows [begin, end) to cover the rows and returns whether it was empty before
+static int extendRange(int* begin, int* end, const int y, const int count)
+{
+	if (*begin >= *end)
+	{
+		*begin = y;
+		*end = y + count;
+		return 1;
+	}
+
+	if (y < *begin) *begin = y;
+	if (y + count > *end) *end = y + count;
+	return 0;
+}
+
+// Copies the pending rows into ring slots on the decoder thread, so the GL thread never reads `dst`
+static void flushRows(struct ImageLoad* load)
+{
+	struct UploadRing* ring = load->ring;
+	while (load->ringBegin < load->ringEnd)
+	{
+		unsigned char* slot = acquireUploadSlot(ring);
+		if (!slot) break;
+
+		const int left = load->ringEnd - load->ringBegin, rows = left < ring->slotRows ? left : ring->slotRows;
+		const unsigned char* src = (const unsigned char*)load->dst + (size_t)load->ringBegin * load->stride;
+		for (int r = 0; r < rows; ++r)
+			memcpy(slot + (size_t)r * ring->stride, src + (size_t)r * load->stride, ring->stride);
+
+		submitUploadSlot(ring, load->ringBegin, rows);
+		load->ringBegin += rows;
+		if (load->wake) load->wake();
+	}
+
+	load->ringBegin = load->ringEnd = 0;
+}
+
+static int endRows(void* user, const int y, const int count)
+{
+	struct ImageLoad* load = user;
+	const int wake = count > 0 && !load->ring && extendRange(&load->dirtyBegin, &load->dirtyEnd, y, count);
+	pthread_mutex_unlock(&load->lock);
+
+	if (count > 0 && load->ring)
+	{
+		extendRange(&load->ringBegin, &load->ringEnd, y, count);
+		// Rows accumulate while the GL thread still has slots queued, so a fast decoder submits fewer, larger uploads
+		if (isUploadRingIdle(load->ring)) flushRows(load);
+	}
+	if (wake && load->wake) load->wake();
+
+	return !atomic_load(&load->cancel);
+}
+
+static void* loadThread(void* arg)
+{
+	struct ImageLoad* load = arg;
+	const struct RowSink sink = {beginRows, endRows, load};
+
+	const int ok = parseImageProgressive(load->data, load->size, &load->info, load->dst, load->stride, &sink);
+	if (load->ring) flushRows(load);
+
+	pthread_mutex_lock(&load->lock);
+	load->result = ok;
+	pthread_mutex_unlock(&load->lock);
+	atomic_store(&load->done, 1);
+	if (load->wake) load->wake();
+
+	return NULL;
+}
+
+struct ImageLoad* startImageLoad(const unsigned char* data, const size_t size, const struct ImageInfo* info,
+                                 void* dst, const size_t stride, const ImageLoadWake wake, struct UploadRing* ring)
+{
+	if (!data || !size || !info || !dst) return NULL;
+
+	struct ImageLoad* load = calloc(1, sizeof(*load));
+	if (!load)
+	{
+		fprintf(stderr, "Failed to allocate image load\n");
+		return NULL;
+	}
+
+	load->data = data;
+	load->size = size;
+	load->info = *info;
+	load->dst = dst;
+	load->stride = stride;
+	load->wake = wake;
+	load->ring = ring;
+	pthread_mutex_init(&load->lock, NULL);
+	atomic_init(&load->done, 0);
+	atomic_init(&load->cancel, 0);
+
+	if (pthread_create(&load->thread, NULL, loadThread, load) != 0)
+	{
+		fprintf(stderr, "Failed to start decoder thread\n");
+		pthread_mutex_destroy(&load->lock);
+		free(load);
+
+		return NULL;
+	}
+
+	return load;
+}
+
+int lockLoadedRows(struct ImageLoad* load, int* y, int* count)
+{
+	pthread_mutex_lock(&load->lock);
+
+	*y = load->dirtyBegin;
+	*count = load->dirtyEnd - load->dirtyBegin;
+	load->dirtyBegin = load->dirtyEnd = 0;
+
+	return *count > 0;
+}
+
+void unlockLoadedRows(struct ImageLoad* load)
+{
+	pthread_mutex_unlock(&load->lock);
+}
+
+int isImageLoadDone(struct ImageLoad* load)
+{
+	return atomic_load(&load->done);
+}
+
+int finishImageLoad(struct ImageLoad* load, const int cancel)
+{
+	if (!load) return 0;
+
+	if (cancel) atomic_store(&load->cancel, 1);
+	if (cancel && load->ring) closeUploadRing(load->ring);
+	pthread_join(load->thread, NULL);
+
+	const int result = load->result;
+	pthread_mutex_destroy(&load->lock);
+	free(load);
+
+	return result;
+}
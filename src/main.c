@@ -1,10 +1,20 @@
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 #include "include/renderer.h"
 #include "include/parser.h"
+#include "include/budget.h"
+#include "include/diskcache.h"
+#include "include/animation.h"
+#include "include/loader.h"
+#include "include/platform.h"
+#include "include/sequence.h"
+#include "include/writer.h"
+#include "include/softrender.h"
 
-struct Pixel* pixels = NULL;
 int imageWidth = 0, imageHeight = 0;
 size_t count = 0;
 struct GLObjects gl = {0};
@@ -45,46 +55,501 @@ char* readFile(const char* filename, size_t* outSize)
 	return buffer;
 }
 
+// Renders `frames` frames with the software backend, without a window or GL context, and writes the last one out
+static int renderHeadless(const struct ImageInfo* info, const void* pixels, const char* outPath, const int frames)
+{
+	struct SoftObjects soft = {0};
+	const int created = info->format == PIXEL_FORMAT_POINT ? createSoftObjects(&soft, pixels, count)
+	                                                       : createSoftTextureObjects(&soft, info, pixels);
+	if (!created || !updateSoftPositions(&soft, info->width + PADDING * 2, info->height + PADDING * 2))
+	{
+		destroySoftObjects(&soft);
+		return EXIT_FAILURE;
+	}
+	setSoftClearColor(&soft, 0.08f, 0.09f, 0.12f, 1.0f);
+
+	struct timespec start, end;
+	timespec_get(&start, TIME_UTC);
+	for (int i = 0; i < frames; ++i) renderSoft(&soft);
+	timespec_get(&end, TIME_UTC);
+
+	const double ms = (double)(end.tv_sec - start.tv_sec) * 1e3 + (double)(end.tv_nsec - start.tv_nsec) / 1e6;
+	printf("Rendered %d frame(s) of %dx%d on %d thread(s) in %.2f ms (%.3f ms/frame)\n", frames, soft.width,
+	       soft.height, soft.threadCount, ms, ms / frames);
+
+	const int written = writeSoftFramePPM(&soft, outPath);
+	destroySoftObjects(&soft);
+
+	return written ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static void printFrameStats(void)
+{
+	const struct FrameStats* fs = getFrameStats();
+	printf("Frames: %llu redraws, %llu wakeups, %.3f ms last, %.3f ms average, %.3f ms max\n", fs->frames, fs->wakeups,
+	       fs->lastFrameTime * 1e3, fs->frames ? fs->totalFrameTime * 1e3 / (double)fs->frames : 0.0,
+	       fs->maxFrameTime * 1e3);
+}
+
+static void printCacheStats(struct ImageCache* cache)
+{
+	struct ImageCacheStats cs;
+	getImageCacheStats(cache, &cs);
+	const size_t lookups = cs.hits + cs.misses;
+	printf("Image cache: %zu hits, %zu misses (%.1f%% hit rate), %zu evictions, %zu entries, %.1f of %.1f MB\n",
+	       cs.hits, cs.misses, lookups ? 100.0 * (double)cs.hits / (double)lookups : 0.0, cs.evictions, cs.entries,
+	       (double)cs.bytes / 1048576.0, (double)cs.budget / 1048576.0);
+}
+
+// Shrinks images that do not fit the window; the texture is sampled nearest, like the 1:1 view
+static void fitImageScale(GLFWwindow* window, const struct ImageInfo* info)
+{
+	int w, h;
+	glfwGetFramebufferSize(window, &w, &h);
+	double scale = 1.0;
+	if ((double)(w - PADDING * 2) / info->width < scale) scale = (double)(w - PADDING * 2) / info->width;
+	if ((double)(h - PADDING * 2) / info->height < scale) scale = (double)(h - PADDING * 2) / info->height;
+	setUniform3f(gl.program, "uImage", (float)info->width, (float)info->height, scale > 0.0 ? (float)scale : 1.0f);
+}
+
+static int sequenceStep = 0, sequenceJump = -1;
+
+// ReSharper disable once CppParameterMayBeConstPtrOrRef
+static void sequenceKeyCallback(GLFWwindow* window, const int key, const int scancode, const int action, const int mods)
+{
+	(void)window;
+	(void)scancode;
+	(void)mods;
+	if (action == GLFW_RELEASE) return;
+
+	switch (key)
+	{
+		case GLFW_KEY_RIGHT:
+		case GLFW_KEY_DOWN:
+		case GLFW_KEY_PAGE_DOWN:
+		case GLFW_KEY_SPACE:
+			sequenceStep++;
+			break;
+		case GLFW_KEY_LEFT:
+		case GLFW_KEY_UP:
+		case GLFW_KEY_PAGE_UP:
+		case GLFW_KEY_BACKSPACE:
+			sequenceStep--;
+			break;
+		case GLFW_KEY_HOME:
+			sequenceJump = 0;
+			break;
+		case GLFW_KEY_END:
+			sequenceJump = INT_MAX;
+			break;
+		default:
+			break;
+	}
+}
+
+static void setSequenceTitle(GLFWwindow* window, const struct Sequence* sequence, const int index, const char* state)
+{
+	const char* path = getSequencePath(sequence, index);
+	const char* name = path;
+	for (const char* c = path; *c; ++c)
+		if (*c == '/' || *c == '\\') name = c + 1;
+
+	char title[512];
+	snprintf(title, sizeof(title), "ImageParser - %s (%d/%d)%s", name, index + 1, getSequenceLength(sequence), state);
+	glfwSetWindowTitle(window, title);
+}
+
+static int transcodeImage(const struct ImageInfo* info, const void* pixels, const char* outPath, const int threads,
+                          const int stats)
+{
+	const double start = getTime();
+	if (!writeImage(outPath, info, pixels, info->stride, threads)) return EXIT_FAILURE;
+
+	if (stats)
+	{
+		const double elapsed = getTime() - start;
+		printf("Wrote %s: %dx%d in %.3f ms, %.1f MB/s of pixels on %d threads\n", outPath, info->width, info->height,
+		       elapsed * 1e3, elapsed > 0.0 ? (double)info->size / elapsed / 1e6 : 0.0, threads);
+	}
+
+	return EXIT_SUCCESS;
+}
+
+// Swaps the texture to the image at `index` once a worker has decoded it; returns 0 while it is still pending
+static int showSequenceImage(GLFWwindow* window, struct Sequence* sequence, const int index, struct ImageInfo* info)
+{
+	const void* pixels;
+	const int state = lockSequenceImage(sequence, index, info, &pixels);
+	if (!state) return 0;
+
+	destroyObjects(&gl);
+	int shown = 0;
+	if (state > 0)
+	{
+		shown = createTextureObjects(&gl, info, pixels);
+		unlockSequenceImage(sequence, index);
+	}
+	if (!shown) destroyObjects(&gl);
+
+	int w, h;
+	glfwGetFramebufferSize(window, &w, &h);
+	updatePositions(w, h);
+	setSequenceTitle(window, sequence, index, shown ? "" : " - failed");
+	invalidateFrame();
+
+	return 1;
+}
+
+// Steps through a directory or glob with the keyboard while workers decode the images around the cursor
+static int runSequence(const char* pattern, const int prefetch, const size_t budget, const int stats)
+{
+	GLFWwindow* window = createWindow(MAX_WINDOW_WIDTH, MAX_WINDOW_HEIGHT, "ImageParser");
+	if (!window) return EXIT_FAILURE;
+
+	if (!initGLEW())
+	{
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+
+	// The cache shares the budget: images in the prefetch window are pinned in it, and whatever room they leave keeps
+	// images the cursor moved away from, so stepping back costs a hash and a lookup
+	struct ImageCache* cache = createImageCache(budget);
+	struct Sequence* sequence = cache ? openSequence(pattern, prefetch, prefetch, budget, cache, glfwPostEmptyEvent)
+	                                  : NULL;
+	if (!sequence)
+	{
+		destroyImageCache(cache);
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+
+	glfwSetKeyCallback(window, sequenceKeyCallback);
+	glClearColor(0.08f, 0.09f, 0.12f, 1.0f);
+
+	struct ImageInfo info = {0};
+	int cursor = 0, shown = -1;
+	setSequenceCursor(sequence, cursor);
+	setSequenceTitle(window, sequence, cursor, " - loading");
+
+	while (!glfwWindowShouldClose(window))
+	{
+		if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) glfwSetWindowShouldClose(window, GLFW_TRUE);
+
+		if (sequenceStep || sequenceJump >= 0)
+		{
+			const long long next = sequenceJump >= 0 ? sequenceJump : (long long)cursor + sequenceStep;
+			const int last = getSequenceLength(sequence) - 1;
+			sequenceStep = 0;
+			sequenceJump = -1;
+
+			if (next != cursor)
+			{
+				cursor = next < 0 ? 0 : next > last ? last : (int)next;
+				setSequenceCursor(sequence, cursor);
+				if (cursor != shown) setSequenceTitle(window, sequence, cursor, " - loading");
+			}
+		}
+
+		// The previous image stays up until the worker decoding the new one wakes the loop
+		if (cursor != shown && showSequenceImage(window, sequence, cursor, &info)) shown = cursor;
+
+		if (beginFrame())
+		{
+			glClear(GL_COLOR_BUFFER_BIT);
+			if (gl.texture)
+			{
+				fitImageScale(window, &info);
+				render(&gl, 1);
+			}
+			endFrame(window);
+		}
+
+		waitForEvents(0);
+	}
+
+	// Workers post wake events, so they are stopped before GLFW goes away
+	closeSequence(sequence);
+	if (stats)
+	{
+		printFrameStats();
+		printCacheStats(cache);
+	}
+	destroyImageCache(cache);
+	destroyObjects(&gl);
+	glfwTerminate();
+
+	return EXIT_SUCCESS;
+}
+
+// Plays an APNG: each frame only re-uploads the rectangle that changed, and the next frame decodes while this one shows
+static int runAnimation(const unsigned char* data, const size_t size, const struct ImageInfo* header, const int stats)
+{
+	const int windowWidth = header->width + PADDING * 2, windowHeight = header->height + PADDING * 2;
+	GLFWwindow* window = createWindow(windowWidth < MAX_WINDOW_WIDTH ? windowWidth : MAX_WINDOW_WIDTH,
+	                                  windowHeight < MAX_WINDOW_HEIGHT ? windowHeight : MAX_WINDOW_HEIGHT,
+	                                  "ImageParser");
+	if (!window) return EXIT_FAILURE;
+
+	if (!initGLEW())
+	{
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+
+	struct Animation* animation = openAnimation(data, size, header, glfwPostEmptyEvent);
+	const struct ImageInfo* info = animation ? getAnimationInfo(animation) : NULL;
+	if (!info || !createTextureObjects(&gl, info, NULL))
+	{
+		closeAnimation(animation);
+		destroyObjects(&gl);
+		glfwTerminate();
+
+		return EXIT_FAILURE;
+	}
+
+	int w, h;
+	glfwGetFramebufferSize(window, &w, &h);
+	updatePositions(w, h);
+	glClearColor(0.08f, 0.09f, 0.12f, 1.0f);
+
+	int status = EXIT_SUCCESS, shown = 0, playing = 1, pending = 1;
+	double due = glfwGetTime();
+	while (!glfwWindowShouldClose(window))
+	{
+		if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) glfwSetWindowShouldClose(window, GLFW_TRUE);
+
+		const double now = glfwGetTime();
+		if (playing && now >= due)
+		{
+			const void* canvas;
+			struct AnimationRect dirty;
+			double delay;
+			const int state = lockAnimationFrame(animation, &canvas, &dirty, &delay);
+			pending = state == 0;
+			if (state > 0)
+			{
+				updateTextureRect(&gl, info, canvas, dirty.x, dirty.y, dirty.width, dirty.height);
+				unlockAnimationFrame(animation);
+				invalidateFrame();
+				shown = 1;
+
+				// Keep the cadence, but a frame that arrives more than a delay late restarts it instead of rushing
+				due = due + delay > now ? due + delay : now + delay;
+			}
+			else if (state < 0)
+			{
+				fprintf(stderr, "Failed to decode animation frame\n");
+				playing = 0;
+				if (!shown)
+				{
+					glfwSetWindowShouldClose(window, GLFW_TRUE);
+					status = EXIT_FAILURE;
+				}
+			}
+		}
+
+		if (beginFrame())
+		{
+			glClear(GL_COLOR_BUFFER_BIT);
+			if (shown)
+			{
+				fitImageScale(window, info);
+				render(&gl, 1);
+			}
+			endFrame(window);
+		}
+
+		// A pending frame posts an empty event once it is composited; otherwise sleep until the next one is due
+		if (!playing || pending) waitForEvents(0);
+		else waitForEventsTimeout(due - glfwGetTime());
+	}
+
+	if (stats) printFrameStats();
+
+	// The animation thread posts wake events, so it is stopped before GLFW goes away
+	closeAnimation(animation);
+	destroyObjects(&gl);
+	glfwTerminate();
+
+	return status;
+}
+
 int main(int argc, char** argv)
 {
-	if (argc < 2)
+	const char *path = NULL, *cacheDir = NULL, *headlessPath = NULL, *transcodePath = NULL;
+	int forceTiled = 0, frames = 1, stats = 0, prefetch = 2, threads = getProcessorCount();
+	size_t budgetMB = 1024, maxMemoryMB = DEFAULT_DECODE_MEMORY >> 20, maxDiskMB = DEFAULT_DECODE_DISK >> 20;
+	const char* spillDir = NULL;
+	int verify = CHECKSUM_FULL;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) cacheDir = argv[++i];
+		else if (strcmp(argv[i], "--tiled") == 0) forceTiled = 1;
+		else if (strcmp(argv[i], "--headless") == 0 && i + 1 < argc) headlessPath = argv[++i];
+		else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) frames = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--stats") == 0) stats = 1;
+		else if (strcmp(argv[i], "--transcode") == 0 && i + 1 < argc) transcodePath = argv[++i];
+		else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) threads = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--prefetch") == 0 && i + 1 < argc) prefetch = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--budget") == 0 && i + 1 < argc) budgetMB = strtoull(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--max-memory") == 0 && i + 1 < argc) maxMemoryMB = strtoull(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--max-disk") == 0 && i + 1 < argc) maxDiskMB = strtoull(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--spill") == 0 && i + 1 < argc) spillDir = argv[++i];
+		else if (strcmp(argv[i], "--verify") == 0 && i + 1 < argc)
+		{
+			const char* mode = argv[++i];
+			verify = strcmp(mode, "full") == 0 ? CHECKSUM_FULL
+			         : strcmp(mode, "critical") == 0 ? CHECKSUM_CRITICAL
+			         : strcmp(mode, "none") == 0 ? CHECKSUM_NONE : -1;
+		}
+		else path = argv[i];
+	}
+
+	if (!path || frames < 1 || prefetch < 0 || threads < 1 || verify < 0)
 	{
-		fprintf(stderr, "Usage: %s <image_path>\n", argv[0]);
+		fprintf(stderr,
+		        "Usage: %s [--cache <dir>] [--tiled] [--stats] [--headless <out.ppm> [--frames <n>]] <image_path>\n"
+		        "       %s [--cache <dir>] [--threads <n>] [--stats] --transcode <out.png | out.ppm> <image_path>\n"
+		        "       %s [--prefetch <n>] [--budget <MB>] [--stats] <directory | glob>\n"
+		        "All modes take --verify <full | critical | none> to choose which PNG checksums are checked, and\n"
+		        "--max-memory <MB>, --max-disk <MB> and --spill <dir> to bound a single decode: decodes over the\n"
+		        "memory limit go to temporary files in the spill directory, and those over both are refused\n",
+		        argv[0], argv[0], argv[0]);
 		return EXIT_FAILURE;
 	}
+	setDefaultChecksumPolicy((enum ChecksumPolicy)verify);
+	setDecodeBudget(maxMemoryMB << 20, maxDiskMB << 20, spillDir);
 
+	// A directory or a pattern opens the sequence viewer; the pattern is expanded here so shells that do not glob work
+	if (isDirectory(path) || strpbrk(path, "*?[")) return runSequence(path, prefetch, budgetMB << 20, stats);
+
+	struct DiskCachedImage cached = {0};
+	struct ImageInfo info;
 	size_t contentSize = 0;
-	char* content = readFile(argv[1], &contentSize);
-	if (!content)
+	char* content = NULL;
+
+	if (cacheDir)
 	{
-		fprintf(stderr, "Failed to read file: %s\n", argv[1]);
-		return EXIT_FAILURE;
+		if (!openDiskCachedImage(cacheDir, path, PIXEL_FORMAT_NATIVE, &cached))
+		{
+			fprintf(stderr, "Failed to parse image: %s\n", path);
+			return EXIT_FAILURE;
+		}
+		info = cached.info;
 	}
+	else
+	{
+		content = readFile(path, &contentSize);
+		if (!content)
+		{
+			fprintf(stderr, "Failed to read file: %s\n", path);
+			return EXIT_FAILURE;
+		}
+
+		if (!getImageInfo((const unsigned char*)content, contentSize, PIXEL_FORMAT_NATIVE, &info))
+		{
+			fprintf(stderr, "Failed to parse image: %s\n", path);
+			free(content);
 
-	pixels = parseImage((const unsigned char*)content, contentSize, &count, &imageWidth, &imageHeight);
-	if (!pixels || count == 0)
+			return EXIT_FAILURE;
+		}
+	}
+
+	// APNGs play in their own loop; headless runs, the tiled view and the disk cache show the default image only
+	if (content && !headlessPath && !transcodePath && !forceTiled && !info.outOfCore && isAnimatedImage(&info))
 	{
-		fprintf(stderr, "Failed to parse image: %s\n", argv[1]);
+		const int status = runAnimation((const unsigned char*)content, contentSize, &info, stats);
 		free(content);
-		free(pixels);
 
-		return EXIT_FAILURE;
+		return status;
 	}
 
+	imageWidth = info.width;
+	imageHeight = info.height;
+	count = (size_t)imageWidth * (size_t)imageHeight;
+
 	if (imageWidth <= 0 || imageHeight <= 0)
 	{
 		fprintf(stderr, "Invalid image dimensions: %dx%d\n", imageWidth, imageHeight);
 		free(content);
-		free(pixels);
+		closeDiskCachedImage(&cached);
 
 		return EXIT_FAILURE;
 	}
 
-	GLFWwindow* window = createWindow(imageWidth + PADDING * 2, imageHeight + PADDING * 2, "ImageParser");
+	// Images larger than the window are decoded up front into a mip pyramid and streamed to the GPU tile by tile.
+	// Headless runs and transcodes decode up front as well and never touch GLFW or the GL.
+	const int headless = headlessPath != NULL || transcodePath != NULL;
+	const int tiled = !headless && (forceTiled || imageWidth + PADDING * 2 > MAX_WINDOW_WIDTH ||
+		imageHeight + PADDING * 2 > MAX_WINDOW_HEIGHT);
+	struct Pyramid pyramid = {0};
+	struct DecodeBuffer decoded = {0};
+	if (tiled || headless)
+	{
+		// Palette indices cannot be averaged, so tiled palette images are expanded to RGBA once
+		if (tiled && !canBuildPyramid(info.format))
+		{
+			if (cacheDir)
+			{
+				closeDiskCachedImage(&cached);
+				if (openDiskCachedImage(cacheDir, path, PIXEL_FORMAT_RGBA8, &cached)) info = cached.info;
+			}
+			else if (!setImageFormat(&info, PIXEL_FORMAT_RGBA8))
+			{
+				free(content);
+				content = NULL;
+			}
+		}
+		// The mip levels live alongside the image, so they count towards its budget and follow it out of core
+		if (tiled && !planDecode(&info, getPyramidSize(&info)))
+		{
+			free(content);
+			content = NULL;
+			closeDiskCachedImage(&cached);
+		}
+
+		// Huge images decode straight into a temporary file mapping once they are over the memory budget
+		const void* pixels = cached.pixels;
+		if (content)
+		{
+			void* dst = allocDecodeBuffer(info.size, info.outOfCore, &decoded);
+			if (dst && parseImageInto((const unsigned char*)content, contentSize, &info, dst, info.stride))
+				pixels = dst;
+			free(content);
+			content = NULL;
+		}
+
+		if (!pixels || (tiled && !buildPyramid(&pyramid, &info, pixels)))
+		{
+			fprintf(stderr, "Failed to parse image: %s\n", path);
+			freeDecodeBuffer(&decoded);
+			closeDiskCachedImage(&cached);
+
+			return EXIT_FAILURE;
+		}
+
+		if (headless)
+		{
+			const int status = transcodePath ? transcodeImage(&info, pixels, transcodePath, threads, stats)
+			                                 : renderHeadless(&info, pixels, headlessPath, frames);
+			freeDecodeBuffer(&decoded);
+			closeDiskCachedImage(&cached);
+
+			return status;
+		}
+	}
+
+	const int windowWidth = imageWidth + PADDING * 2, windowHeight = imageHeight + PADDING * 2;
+	GLFWwindow* window = createWindow(windowWidth < MAX_WINDOW_WIDTH ? windowWidth : MAX_WINDOW_WIDTH,
+	                                  windowHeight < MAX_WINDOW_HEIGHT ? windowHeight : MAX_WINDOW_HEIGHT,
+	                                  "ImageParser");
 	if (!window)
 	{
 		free(content);
-		free(pixels);
+		destroyPyramid(&pyramid);
+		freeDecodeBuffer(&decoded);
+		closeDiskCachedImage(&cached);
 
 		return EXIT_FAILURE;
 	}
@@ -92,41 +557,155 @@ int main(int argc, char** argv)
 	if (!initGLEW())
 	{
 		free(content);
-		free(pixels);
+		destroyPyramid(&pyramid);
+		freeDecodeBuffer(&decoded);
+		closeDiskCachedImage(&cached);
 		glfwTerminate();
 
 		return EXIT_FAILURE;
 	}
 
-	if (!createObjects(&gl, pixels, count))
+	// Images are uploaded in their native format; only formats without a texture path fall back to point sprites
+	const int textured = info.format != PIXEL_FORMAT_POINT;
+	int created;
+	if (tiled) created = createTileObjects(&gl, &pyramid);
+	else
+	{
+		created = textured ? createTextureObjects(&gl, &info, cached.pixels) : createObjects(&gl, cached.pixels, count);
+		closeDiskCachedImage(&cached);
+	}
+
+	if (!created)
 	{
 		free(content);
-		free(pixels);
 		destroyObjects(&gl);
+		destroyPyramid(&pyramid);
+		freeDecodeBuffer(&decoded);
+		closeDiskCachedImage(&cached);
 		glfwTerminate();
 
 		return EXIT_FAILURE;
 	}
 
+	// PNGs decode on a background thread so the window shows rows, and every Adam7 pass, as soon as they are published.
+	// The decoder thread copies finished rows into the upload ring itself; this thread only issues the transfers.
+	struct ImageLoad* load = NULL;
+	struct DecodeBuffer loadBuffer = {0};
+	if (content && textured && isProgressiveImage(&info))
+	{
+		void* loadPixels = allocDecodeBuffer(info.size, info.outOfCore, &loadBuffer);
+		struct UploadRing* ring = loadPixels ? createUploadRing(&gl, &info) : NULL;
+		if (ring)
+			load = startImageLoad((const unsigned char*)content, contentSize, &info, loadPixels, info.stride,
+			                      glfwPostEmptyEvent, ring);
+		if (!load)
+		{
+			freeDecodeBuffer(&loadBuffer);
+			free(content);
+			destroyObjects(&gl);
+			glfwTerminate();
+
+			return EXIT_FAILURE;
+		}
+	}
+	else if (content)
+	{
+		void* mapped = textured ? mapTextureObjects(&gl, &info) : (void*)mapObjects(&gl, count);
+		const int parsed = mapped &&
+			parseImageInto((const unsigned char*)content, contentSize, &info, mapped, info.stride);
+		free(content);
+		content = NULL;
+
+		const int unmapped = mapped && (textured ? unmapTextureObjects(&gl, &info) : unmapObjects(&gl));
+		if (!unmapped || !parsed)
+		{
+			if (!parsed) fprintf(stderr, "Failed to parse image: %s\n", path);
+			destroyObjects(&gl);
+			glfwTerminate();
+
+			return EXIT_FAILURE;
+		}
+	}
+
 	int w, h;
 	glfwGetFramebufferSize(window, &w, &h);
 	updatePositions(w, h);
 	glClearColor(0.08f, 0.09f, 0.12f, 1.0f);
 
+	struct View view;
+	if (tiled)
+	{
+		initView(&view, imageWidth, imageHeight, w, h);
+		attachViewControls(window, &view);
+	}
+
+	int status = EXIT_SUCCESS, pending = 0;
 	while (!glfwWindowShouldClose(window))
 	{
 		if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) glfwSetWindowShouldClose(window, GLFW_TRUE);
-		glClear(GL_COLOR_BUFFER_BIT);
-		render(&gl, (int)count);
 
-		glfwSwapBuffers(window);
-		glfwPollEvents();
+		int uploading = 0;
+		if (gl.uploads)
+		{
+			// Read the flag first: every slot is submitted before it is set, so a final flush picks them all up
+			const int done = !load || isImageLoadDone(load);
+			uploading = flushUploadRing(&gl, &info);
+
+			if (load && done)
+			{
+				if (!finishImageLoad(load, 0))
+				{
+					fprintf(stderr, "Failed to parse image: %s\n", path);
+					glfwSetWindowShouldClose(window, GLFW_TRUE);
+					status = EXIT_FAILURE;
+				}
+				load = NULL;
+
+				freeDecodeBuffer(&loadBuffer);
+				free(content);
+				content = NULL;
+			}
+			if (done && !uploading) destroyUploadRing(&gl);
+		}
+
+		if (tiled)
+		{
+			glfwGetFramebufferSize(window, &w, &h);
+			resizeView(&view, w, h);
+			if (view.dirty) invalidateFrame();
+			view.dirty = 0;
+		}
+
+		if (beginFrame())
+		{
+			glClear(GL_COLOR_BUFFER_BIT);
+			if (tiled)
+			{
+				// Tiles still missing after this frame's upload budget need another pass right away
+				pending = renderTiles(&gl, &pyramid, &view) > 0;
+				if (pending) invalidateFrame();
+			}
+			else render(&gl, (int)count);
+
+			endFrame(window);
+		}
+
+		// Sleep until input, a resize or expose, or the decoder thread posts an empty event for new rows. Transfers in
+		// flight keep the loop polling so their slots are recycled as soon as the GPU is done with them.
+		waitForEvents(pending || uploading);
 	}
 
+	if (stats) printFrameStats();
+
+	if (load) finishImageLoad(load, 1);
+	freeDecodeBuffer(&loadBuffer);
 	free(content);
-	free(pixels);
+
 	destroyObjects(&gl);
+	destroyPyramid(&pyramid);
+	freeDecodeBuffer(&decoded);
+	closeDiskCachedImage(&cached);
 	glfwTerminate();
 
-	return EXIT_SUCCESS;
+	return status;
 }
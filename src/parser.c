@@ -1,58 +1,45 @@
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "./include/renderer.h"
+#include "./include/budget.h"
 #include "./include/parser.h"
+#include "./include/convert.h"
+#include "./include/png.h"
 
 struct Pixel* parseImage(const unsigned char* data, const size_t size, size_t* count, int* width, int* height)
 {
 	if (!data || !size || !count || !width || !height) return NULL;
+	*count = 0;
 
-	const int type = getImageType(data, size);
-	switch (type)
+	struct ImageInfo info;
+	if (!getImageInfo(data, size, PIXEL_FORMAT_POINT, &info)) return NULL;
+	if (info.outOfCore)
 	{
-		case IMAGE_TYPE_PPM_P3:
-			return parsePPM_P3(data, size, count, width, height);
-		case IMAGE_TYPE_PPM_P6:
-			return parsePPM_P6(data, size, count, width, height);
-		case IMAGE_TYPE_PGM_P5:
-			return parsePGM_P5(data, size, count, width, height);
-		case IMAGE_TYPE_PBM_P4:
-			return parsePBM_P4(data, size, count, width, height);
-		case IMAGE_TYPE_BMP_24:
-			return parseBMP_24(data, size, count, width, height);
-		case IMAGE_TYPE_BMP_32:
-			return parseBMP_32(data, size, count, width, height);
-		case IMAGE_TYPE_TGA_24:
-			return parseTGA_24(data, size, count, width, height);
-		case IMAGE_TYPE_TGA_32:
-			return parseTGA_32(data, size, count, width, height);
-		case IMAGE_TYPE_TGA_RLE:
-			return parseTGA_RLE(data, size, count, width, height);
-		case IMAGE_TYPE_PNG_8BIT:
-			return parsePNG_8bit(data, size, count, width, height);
-		case IMAGE_TYPE_PNG_TRNS:
-			return parsePNG_TRNS(data, size, count, width, height);
-		case IMAGE_TYPE_PNG_PLTE:
-			return parsePNG_PLTE(data, size, count, width, height);
-		case IMAGE_TYPE_PNG_GRAYSCALE:
-			return parsePNG_Grayscale(data, size, count, width, height);
-		case IMAGE_TYPE_PNG_16BIT:
-			return parsePNG_16bit(data, size, count, width, height);
-		case IMAGE_TYPE_PNG_ADAM7:
-			return parsePNG_ADAM7(data, size, count, width, height);
-		case IMAGE_TYPE_TIFF_BASELINE:
-			return parseTIFF_Baseline(data, size, count, width, height);
-		case IMAGE_TYPE_JPEG_BASELINE:
-			return parseJPEG_Baseline(data, size, count, width, height);
-		default:
-			fprintf(stderr, "Unknown image type: %d\n", type);
-			break;
+		fprintf(stderr, "Image too large to render as points: %zu bytes\n", info.size);
+		return NULL;
 	}
 
-	*count = 0;
-	return NULL;
+	struct Pixel* pixels = malloc(info.size);
+	if (!pixels)
+	{
+		fprintf(stderr, "Failed to allocate memory for %zu pixels\n", (size_t)info.width * (size_t)info.height);
+		return NULL;
+	}
+
+	if (!parseImageInto(data, size, &info, pixels, info.stride))
+	{
+		free(pixels);
+		return NULL;
+	}
+
+	*width = info.width;
+	*height = info.height;
+	*count = (size_t)info.width * (size_t)info.height;
+
+	return pixels;
 }
 
 int getImageType(const unsigned char* data, const size_t size)
@@ -260,350 +247,461 @@ static int readPPMHeader(const unsigned char* data, const size_t size, const cha
 	return 1;
 }
 
-struct Pixel* parsePPM_P3(const unsigned char* data, const size_t size, size_t* count, int* width, int* height)
+static int readPBMHeader(const unsigned char* data, const size_t size, int* width, int* height,
+                         const unsigned char** outP)
 {
-	const unsigned char *p, *end;
-	int maxVal;
+	if (!data || size < 2) return 0;
+	const unsigned char *p = data, *end = data + size;
 
-	if (!count || !width || !height) return NULL;
-	if (!readPPMHeader(data, size, "P3", width, height, &maxVal, &p, &end)) return NULL;
+	skipWhitespace(&p, end);
+	if (p + 2 > end || p[0] != 'P' || p[1] != '4')
+	{
+		fprintf(stderr, "Invalid header: expected 'P4'\n");
+		return 0;
+	}
+	p += 2;
 
-	const size_t w = (size_t)*width, h = (size_t)*height;
-	if (w == 0 || h == 0 || w > SIZE_MAX / sizeof(struct Pixel) / h)
+	if (!readUint(&p, end, width))
 	{
-		fprintf(stderr, "Image too large: %dx%d exceeds maximum pixel count\n", *width, *height);
-		return NULL;
+		fprintf(stderr, "Invalid header: expected width\n");
+		return 0;
+	}
+	if (!readUint(&p, end, height))
+	{
+		fprintf(stderr, "Invalid header: expected height\n");
+		return 0;
+	}
+	if (*width <= 0 || *height <= 0)
+	{
+		fprintf(stderr, "Invalid image dimensions: %d x %d\n", *width, *height);
+		return 0;
 	}
 
-	*count = w * h;
-	struct Pixel* pixels = malloc(*count * sizeof(struct Pixel));
-	if (!pixels)
+	skipWhitespace(&p, end);
+	*outP = p;
+
+	return 1;
+}
+
+size_t getPixelFormatSize(const enum PixelFormat format)
+{
+	switch (format)
 	{
-		fprintf(stderr, "Failed to allocate memory for %zu pixels\n", *count);
-		return NULL;
+		case PIXEL_FORMAT_POINT:
+			return sizeof(struct Pixel);
+		case PIXEL_FORMAT_RGB8:
+			return 3;
+		case PIXEL_FORMAT_RGBA8:
+			return 4;
+		case PIXEL_FORMAT_RGBA32F:
+			return 4 * sizeof(float);
+		case PIXEL_FORMAT_INDEX8:
+		case PIXEL_FORMAT_GRAY8:
+			return 1;
+		case PIXEL_FORMAT_GRAY16:
+			return 2;
+		case PIXEL_FORMAT_RGB16:
+			return 6;
+		case PIXEL_FORMAT_RGBA16:
+			return 8;
+		default:
+			return 0;
 	}
+}
 
-	const float invMax = 1.0f / (float)maxVal;
-	for (int y = 0; y < *height; ++y)
-		for (int x = 0; x < *width; ++x)
-		{
-			int r, g, b;
-			if (!readUint(&p, end, &r) || !readUint(&p, end, &g) || !readUint(&p, end, &b))
-			{
-				fprintf(stderr, "Invalid pixel data at (%d, %d)\n", x, y);
-				free(pixels);
+int setImageFormat(struct ImageInfo* info, const enum PixelFormat requested)
+{
+	if (!info || info->width <= 0 || info->height <= 0) return 0;
 
-				return NULL;
-			}
+	const enum PixelFormat format = requested == PIXEL_FORMAT_NATIVE ? info->nativeFormat : requested;
+	const size_t pixelSize = getPixelFormatSize(format);
+	if (!pixelSize)
+	{
+		fprintf(stderr, "Unknown pixel format: %d\n", (int)format);
+		return 0;
+	}
+	if (format == PIXEL_FORMAT_INDEX8 && info->nativeFormat != PIXEL_FORMAT_INDEX8)
+	{
+		fprintf(stderr, "Pixel format %d needs a palette image\n", (int)format);
+		return 0;
+	}
 
-			if (r < 0 || g < 0 || b < 0 || r > maxVal || g > maxVal || b > maxVal)
-			{
-				fprintf(stderr, "Invalid pixel value at (%d, %d): r=%d, g=%d, b=%d (max=%d)\n", x, y, r, g, b, maxVal);
-				free(pixels);
+	const size_t w = (size_t)info->width, h = (size_t)info->height;
+	if (w > SIZE_MAX / pixelSize / h)
+	{
+		fprintf(stderr, "Image too large: %dx%d exceeds maximum pixel count\n", info->width, info->height);
+		return 0;
+	}
 
-				return NULL;
-			}
+	info->format = format;
+	info->stride = w * pixelSize;
+	info->size = info->stride * h;
 
-			struct Pixel* px = &pixels[(size_t)y * (size_t)*width + (size_t)x];
-			px->x = (float)x;
-			px->y = (float)y;
-			px->r = (float)r * invMax;
-			px->g = (float)g * invMax;
-			px->b = (float)b * invMax;
-			px->a = 1.0f;
-			px->size = PIXEL_SIZE;
-		}
+	return planDecode(info, 0);
+}
 
-	return pixels;
+static enum ChecksumPolicy defaultChecksumPolicy = CHECKSUM_FULL;
+
+void setDefaultChecksumPolicy(const enum ChecksumPolicy policy)
+{
+	defaultChecksumPolicy = policy;
 }
 
-struct Pixel* parsePPM_P6(const unsigned char* data, const size_t size, size_t* count, int* width, int* height)
+int getImageInfo(const unsigned char* data, const size_t size, const enum PixelFormat format, struct ImageInfo* info)
 {
-	const unsigned char *p, *end;
-	int maxVal;
+	if (!data || !size || !info) return 0;
+	memset(info, 0, sizeof(*info));
+	info->checksums = defaultChecksumPolicy;
+
+	const unsigned char *p = NULL, *end;
+	int ok;
 
-	if (!count || !width || !height) return NULL;
-	if (!readPPMHeader(data, size, "P6", width, height, &maxVal, &p, &end)) return NULL;
-	if ((size_t)*width * (size_t)*height > SIZE_MAX / sizeof(struct Pixel))
+	info->type = getImageType(data, size);
+	info->nativeFormat = PIXEL_FORMAT_POINT;
+	switch (info->type)
 	{
-		fprintf(stderr, "Image too large: %dx%d exceeds maximum pixel count\n", *width, *height);
-		return NULL;
+		case IMAGE_TYPE_PPM_P3:
+			ok = readPPMHeader(data, size, "P3", &info->width, &info->height, &info->maxVal, &p, &end);
+			info->nativeFormat = info->maxVal > 255 ? PIXEL_FORMAT_RGB16 : PIXEL_FORMAT_RGB8;
+			break;
+		case IMAGE_TYPE_PPM_P6:
+			ok = readPPMHeader(data, size, "P6", &info->width, &info->height, &info->maxVal, &p, &end);
+			info->nativeFormat = info->maxVal > 255 ? PIXEL_FORMAT_RGB16 : PIXEL_FORMAT_RGB8;
+			break;
+		case IMAGE_TYPE_PGM_P5:
+			ok = readPPMHeader(data, size, "P5", &info->width, &info->height, &info->maxVal, &p, &end);
+			info->nativeFormat = info->maxVal > 255 ? PIXEL_FORMAT_GRAY16 : PIXEL_FORMAT_GRAY8;
+			break;
+		case IMAGE_TYPE_PBM_P4:
+			ok = readPBMHeader(data, size, &info->width, &info->height, &p);
+			info->maxVal = 1;
+			info->nativeFormat = PIXEL_FORMAT_GRAY8;
+			break;
+		case IMAGE_TYPE_PNG_8BIT:
+		case IMAGE_TYPE_PNG_PLTE:
+		case IMAGE_TYPE_PNG_TRNS:
+		case IMAGE_TYPE_PNG_GRAYSCALE:
+		case IMAGE_TYPE_PNG_16BIT:
+		case IMAGE_TYPE_PNG_ADAM7:
+			ok = readPNGHeader(data, size, info);
+			if (ok) info->scratchSize = getPNGScratchSize(info);
+			p = data + info->dataOffset;
+			break;
+		case IMAGE_TYPE_UNKNOWN:
+			fprintf(stderr, "Unknown image type: %d\n", info->type);
+			return 0;
+		default:
+			fprintf(stderr, "Not implemented yet!\n");
+			return 0;
 	}
+	if (!ok) return 0;
 
-	*count = (size_t)*width * (size_t)*height;
-	struct Pixel* pixels = malloc(*count * sizeof(struct Pixel));
-	if (!pixels)
+	info->dataOffset = (size_t)(p - data);
+	return setImageFormat(info, format);
+}
+
+int parseImageInto(const unsigned char* data, const size_t size, const struct ImageInfo* info, void* dst,
+                   const size_t stride)
+{
+	if (!data || !size || !info || !dst) return 0;
+	if (info->dataOffset > size || info->width <= 0 || info->height <= 0) return 0;
+	if (stride < info->stride)
 	{
-		fprintf(stderr, "Failed to allocate memory for %zu pixels\n", *count);
-		return NULL;
+		fprintf(stderr, "Output stride %zu is smaller than the %zu bytes a row needs\n", stride, info->stride);
+		return 0;
 	}
 
-	const float invMax = 1.0f / (float)maxVal;
-	const int bytesPerSample = maxVal > 255 ? 2 : 1;
+	switch (info->type)
+	{
+		case IMAGE_TYPE_PPM_P3:
+			return parsePPM_P3(data, size, info, dst, stride);
+		case IMAGE_TYPE_PPM_P6:
+			return parsePPM_P6(data, size, info, dst, stride);
+		case IMAGE_TYPE_PGM_P5:
+			return parsePGM_P5(data, size, info, dst, stride);
+		case IMAGE_TYPE_PBM_P4:
+			return parsePBM_P4(data, size, info, dst, stride);
+		case IMAGE_TYPE_BMP_24:
+			return parseBMP_24(data, size, info, dst, stride);
+		case IMAGE_TYPE_BMP_32:
+			return parseBMP_32(data, size, info, dst, stride);
+		case IMAGE_TYPE_TGA_24:
+			return parseTGA_24(data, size, info, dst, stride);
+		case IMAGE_TYPE_TGA_32:
+			return parseTGA_32(data, size, info, dst, stride);
+		case IMAGE_TYPE_TGA_RLE:
+			return parseTGA_RLE(data, size, info, dst, stride);
+		case IMAGE_TYPE_PNG_8BIT:
+			return parsePNG_8bit(data, size, info, dst, stride);
+		case IMAGE_TYPE_PNG_TRNS:
+			return parsePNG_TRNS(data, size, info, dst, stride);
+		case IMAGE_TYPE_PNG_PLTE:
+			return parsePNG_PLTE(data, size, info, dst, stride);
+		case IMAGE_TYPE_PNG_GRAYSCALE:
+			return parsePNG_Grayscale(data, size, info, dst, stride);
+		case IMAGE_TYPE_PNG_16BIT:
+			return parsePNG_16bit(data, size, info, dst, stride);
+		case IMAGE_TYPE_PNG_ADAM7:
+			return parsePNG_ADAM7(data, size, info, dst, stride);
+		case IMAGE_TYPE_TIFF_BASELINE:
+			return parseTIFF_Baseline(data, size, info, dst, stride);
+		case IMAGE_TYPE_JPEG_BASELINE:
+			return parseJPEG_Baseline(data, size, info, dst, stride);
+		default:
+			fprintf(stderr, "Unknown image type: %d\n", info->type);
+			return 0;
+	}
+}
 
-	for (int y = 0; y < *height; ++y)
-		for (int x = 0; x < *width; ++x)
-		{
-			if ((size_t)(end - p) < (size_t)(3 * bytesPerSample))
-			{
-				fprintf(stderr, "Unexpected end of data at (%d, %d)\n", x, y);
-				free(pixels);
+int isProgressiveImage(const struct ImageInfo* info)
+{
+	const int type = info->type;
+	return type == IMAGE_TYPE_PNG_8BIT || type == IMAGE_TYPE_PNG_TRNS || type == IMAGE_TYPE_PNG_PLTE ||
+		type == IMAGE_TYPE_PNG_GRAYSCALE || type == IMAGE_TYPE_PNG_16BIT || type == IMAGE_TYPE_PNG_ADAM7;
+}
 
-				return NULL;
-			}
+int isAnimatedImage(const struct ImageInfo* info)
+{
+	return info->frameCount > 0 && isProgressiveImage(info);
+}
 
-			int r, g, b;
-			if (bytesPerSample == 1)
-			{
-				r = p[0];
-				g = p[1];
-				b = p[2];
-				p += 3;
-			}
-			else
-			{
-				r = p[0] << 8 | p[1];
-				g = p[2] << 8 | p[3];
-				b = p[4] << 8 | p[5];
-				p += 6;
-			}
+// PNG rows are published as they are inflated, Adam7 images once per row of every pass; other formats decode in one
+// go and publish the whole image at the end.
+int parseImageProgressive(const unsigned char* data, const size_t size, const struct ImageInfo* info, void* dst,
+                          const size_t stride, const struct RowSink* sink)
+{
+	if (!sink) return parseImageInto(data, size, info, dst, stride);
+	if (!data || !size || !info || !dst || info->dataOffset > size || stride < info->stride) return 0;
 
-			struct Pixel* px = &pixels[(size_t)y * (size_t)*width + (size_t)x];
-			px->x = (float)x;
-			px->y = (float)y;
-			px->r = (float)r * invMax;
-			px->g = (float)g * invMax;
-			px->b = (float)b * invMax;
-			px->a = 1.0f;
-			px->size = PIXEL_SIZE;
-		}
+	if (isProgressiveImage(info)) return decodePNG(data, size, info, dst, stride, sink);
 
-	return pixels;
+	sink->beginRows(sink->user);
+	const int ok = parseImageInto(data, size, info, dst, stride);
+	return sink->endRows(sink->user, 0, ok ? info->height : 0) && ok;
 }
 
-struct Pixel* parsePGM_P5(const unsigned char* data, const size_t size, size_t* count, int* width, int* height)
+static int findSampleAbove(const unsigned char* row, const int count, const int bytesPerSample, const int maxVal)
 {
-	const unsigned char *p, *end;
-	int maxVal;
-
-	if (!count || !width || !height) return NULL;
-	if (!readPPMHeader(data, size, "P5", width, height, &maxVal, &p, &end)) return NULL;
-
-	const size_t w = (size_t)*width, h = (size_t)*height;
-	if (w == 0 || h == 0 || w > SIZE_MAX / sizeof(struct Pixel) / h)
+	if (bytesPerSample == 1)
 	{
-		fprintf(stderr, "Image too large: %dx%d exceeds maximum pixel count\n", *width, *height);
-		return NULL;
+		if (maxVal >= 255) return -1;
+		for (int i = 0; i < count; ++i)
+			if (row[i] > maxVal) return i;
 	}
+	else
+		for (int i = 0; i < count; ++i)
+			if ((row[2 * i] << 8 | row[2 * i + 1]) > maxVal) return i;
 
-	*count = w * h;
-	struct Pixel* pixels = malloc(*count * sizeof(struct Pixel));
-	if (!pixels)
+	return -1;
+}
+
+int parsePPM_P3(const unsigned char* data, const size_t size, const struct ImageInfo* info, void* dst,
+                const size_t stride)
+{
+	const unsigned char *p = data + info->dataOffset, *end = data + size;
+	const int maxVal = info->maxVal;
+	const enum RowLayout layout = maxVal > 255 ? ROW_LAYOUT_RGB16 : ROW_LAYOUT_RGB8;
+
+	unsigned char* samples = malloc(getRowLayoutBytes(layout, info->width));
+	struct RowConversion conversion;
+	if (!samples || !initRowConversion(&conversion, layout, info->format, (unsigned int)maxVal, 0.0f))
 	{
-		fprintf(stderr, "Failed to allocate memory for %zu pixels\n", *count);
-		return NULL;
-	}
+		fprintf(stderr, "Failed to allocate row buffer\n");
+		free(samples);
 
-	const int bytesPerSample = maxVal > 255 ? 2 : 1;
-	const float invMax = 1.0f / (float)maxVal;
+		return 0;
+	}
 
-	for (int y = 0; y < *height; ++y)
-		for (int x = 0; x < *width; ++x)
+	int ok = 1;
+	for (int y = 0; y < info->height && ok; ++y)
+	{
+		for (int x = 0; x < info->width; ++x)
 		{
-			if ((size_t)(end - p) < (size_t)bytesPerSample)
+			int r, g, b;
+			if (!readUint(&p, end, &r) || !readUint(&p, end, &g) || !readUint(&p, end, &b))
 			{
-				fprintf(stderr, "Unexpected end of data at (%d, %d)\n", x, y);
-				free(pixels);
-
-				return NULL;
+				fprintf(stderr, "Invalid pixel data at (%d, %d)\n", x, y);
+				ok = 0;
+				break;
 			}
 
-			int value;
-			if (bytesPerSample == 1) value = *p++;
-			else
+			if (r < 0 || g < 0 || b < 0 || r > maxVal || g > maxVal || b > maxVal)
 			{
-				value = p[0] << 8 | p[1];
-				p += 2;
+				fprintf(stderr, "Invalid pixel value at (%d, %d): r=%d, g=%d, b=%d (max=%d)\n", x, y, r, g, b, maxVal);
+				ok = 0;
+				break;
 			}
 
-			if (value < 0 || value > maxVal)
+			if (layout == ROW_LAYOUT_RGB8)
 			{
-				fprintf(stderr, "Invalid pixel value at (%d, %d): %d (max=%d)\n", x, y, value, maxVal);
-				free(pixels);
-
-				return NULL;
+				unsigned char* out = samples + (size_t)x * 3;
+				out[0] = (unsigned char)r;
+				out[1] = (unsigned char)g;
+				out[2] = (unsigned char)b;
+			}
+			else
+			{
+				unsigned char* out = samples + (size_t)x * 6;
+				out[0] = (unsigned char)(r >> 8);
+				out[1] = (unsigned char)r;
+				out[2] = (unsigned char)(g >> 8);
+				out[3] = (unsigned char)g;
+				out[4] = (unsigned char)(b >> 8);
+				out[5] = (unsigned char)b;
 			}
+		}
 
-			struct Pixel* px = &pixels[(size_t)y * (size_t)*width + (size_t)x];
-			const float g = (float)value * invMax;
+		if (!ok) break;
+		conversion.ctx.y = y;
+		conversion.convert(samples, (unsigned char*)dst + (size_t)y * stride, info->width, &conversion.ctx);
+	}
 
-			px->x = (float)x;
-			px->y = (float)y;
-			px->r = g;
-			px->g = g;
-			px->b = g;
-			px->a = 1.0f;
-			px->size = PIXEL_SIZE;
-		}
+	freeRowConversion(&conversion);
+	free(samples);
 
-	return pixels;
+	return ok;
 }
 
-struct Pixel* parsePBM_P4(const unsigned char* data, const size_t size, size_t* count, int* width, int* height)
+static int convertBinaryRows(const unsigned char* data, const size_t size, const struct ImageInfo* info, void* dst,
+                             const size_t stride, const enum RowLayout layout, const int validate)
 {
-	if (!count || !width || !height) return NULL;
-	const unsigned char *p = data, *end = data + size;
-
-	skipWhitespace(&p, end);
-	if (p + 2 > end || p[0] != 'P' || p[1] != '4')
-	{
-		fprintf(stderr, "Invalid header: expected 'P4'\n");
-		return NULL;
-	}
-	p += 2;
-
-	if (!readUint(&p, end, width))
-	{
-		fprintf(stderr, "Invalid header: expected width\n");
-		return NULL;
-	}
-	if (!readUint(&p, end, height))
-	{
-		fprintf(stderr, "Invalid header: expected height\n");
-		return NULL;
-	}
-	if (*width <= 0 || *height <= 0)
-	{
-		fprintf(stderr, "Invalid image dimensions: %d x %d\n", *width, *height);
-		return NULL;
-	}
+	const unsigned char *p = data + info->dataOffset, *end = data + size;
+	const size_t rowBytes = getRowLayoutBytes(layout, info->width);
+	const int bytesPerSample = layout == ROW_LAYOUT_GRAY16 || layout == ROW_LAYOUT_RGB16 ? 2 : 1;
 
-	skipWhitespace(&p, end);
-	const size_t w = (size_t)*width, h = (size_t)*height;
-	if (w == 0 || h == 0 || w > SIZE_MAX / sizeof(struct Pixel) / h)
-	{
-		fprintf(stderr, "Image too large: %dx%d exceeds maximum pixel count\n", *width, *height);
-		return NULL;
-	}
-
-	*count = w * h;
-	struct Pixel* pixels = malloc(*count * sizeof(struct Pixel));
-	if (!pixels)
-	{
-		fprintf(stderr, "Failed to allocate memory for %zu pixels\n", *count);
-		return NULL;
-	}
+	struct RowConversion conversion;
+	if (!initRowConversion(&conversion, layout, info->format, (unsigned int)info->maxVal, 0.0f))
+		return 0;
 
-	const int rowBytes = (*width + 7) / 8;
-	for (int y = 0; y < *height; ++y)
+	int ok = 1;
+	for (int y = 0; y < info->height; ++y)
 	{
-		if ((size_t)(end - p) < (size_t)rowBytes)
+		if ((size_t)(end - p) < rowBytes)
 		{
 			fprintf(stderr, "Unexpected end of data at row %d\n", y);
-			free(pixels);
-
-			return NULL;
+			ok = 0;
+			break;
 		}
 
-		const unsigned char* row = p;
-		for (int x = 0; x < *width; ++x)
+		const int bad = validate ? findSampleAbove(p, info->width, bytesPerSample, info->maxVal) : -1;
+		if (bad >= 0)
 		{
-			const int byteIndex = x / 8;
-			const int bitIndex = 7 - x % 8;
-			const int bit = row[byteIndex] >> bitIndex & 1;
-
-			struct Pixel* px = &pixels[(size_t)y * (size_t)*width + (size_t)x];
-			const float g = bit ? 0.0f : 1.0f;
-
-			px->x = (float)x;
-			px->y = (float)y;
-			px->r = g;
-			px->g = g;
-			px->b = g;
-			px->a = 1.0f;
-			px->size = PIXEL_SIZE;
+			const int value = bytesPerSample == 1 ? p[bad] : p[2 * bad] << 8 | p[2 * bad + 1];
+			fprintf(stderr, "Invalid pixel value at (%d, %d): %d (max=%d)\n", bad, y, value, info->maxVal);
+			ok = 0;
+			break;
 		}
 
+		conversion.ctx.y = y;
+		conversion.convert(p, (unsigned char*)dst + (size_t)y * stride, info->width, &conversion.ctx);
 		p += rowBytes;
 	}
 
-	return pixels;
+	freeRowConversion(&conversion);
+	return ok;
 }
 
-struct Pixel* parseBMP_24(const unsigned char* data, const size_t size, size_t* count, int* width, int* height)
+int parsePPM_P6(const unsigned char* data, const size_t size, const struct ImageInfo* info, void* dst,
+                const size_t stride)
 {
-	fprintf(stderr, "Not implemented yet!\n");
-	return NULL;
+	const enum RowLayout layout = info->maxVal > 255 ? ROW_LAYOUT_RGB16 : ROW_LAYOUT_RGB8;
+	return convertBinaryRows(data, size, info, dst, stride, layout, 0);
 }
 
-struct Pixel* parseBMP_32(const unsigned char* data, const size_t size, size_t* count, int* width, int* height)
+int parsePGM_P5(const unsigned char* data, const size_t size, const struct ImageInfo* info, void* dst,
+                const size_t stride)
 {
-	fprintf(stderr, "Not implemented yet!\n");
-	return NULL;
+	const enum RowLayout layout = info->maxVal > 255 ? ROW_LAYOUT_GRAY16 : ROW_LAYOUT_GRAY8;
+	return convertBinaryRows(data, size, info, dst, stride, layout, 1);
 }
 
-struct Pixel* parseTGA_24(const unsigned char* data, const size_t size, size_t* count, int* width, int* height)
+int parsePBM_P4(const unsigned char* data, const size_t size, const struct ImageInfo* info, void* dst,
+                const size_t stride)
 {
-	fprintf(stderr, "Not implemented yet!\n");
-	return NULL;
+	return convertBinaryRows(data, size, info, dst, stride, ROW_LAYOUT_PBM1, 0);
 }
 
-struct Pixel* parseTGA_32(const unsigned char* data, const size_t size, size_t* count, int* width, int* height)
+int parseBMP_24(const unsigned char* data, const size_t size, const struct ImageInfo* info, void* dst,
+                const size_t stride)
 {
 	fprintf(stderr, "Not implemented yet!\n");
-	return NULL;
+	return 0;
 }
 
-struct Pixel* parseTGA_RLE(const unsigned char* data, const size_t size, size_t* count, int* width, int* height)
+int parseBMP_32(const unsigned char* data, const size_t size, const struct ImageInfo* info, void* dst,
+                const size_t stride)
 {
 	fprintf(stderr, "Not implemented yet!\n");
-	return NULL;
+	return 0;
 }
 
-struct Pixel* parsePNG_8bit(const unsigned char* data, const size_t size, size_t* count, int* width, int* height)
+int parseTGA_24(const unsigned char* data, const size_t size, const struct ImageInfo* info, void* dst,
+                const size_t stride)
 {
 	fprintf(stderr, "Not implemented yet!\n");
-	return NULL;
+	return 0;
 }
 
-struct Pixel* parsePNG_TRNS(const unsigned char* data, const size_t size, size_t* count, int* width, int* height)
+int parseTGA_32(const unsigned char* data, const size_t size, const struct ImageInfo* info, void* dst,
+                const size_t stride)
 {
 	fprintf(stderr, "Not implemented yet!\n");
-	return NULL;
+	return 0;
 }
 
-struct Pixel* parsePNG_PLTE(const unsigned char* data, const size_t size, size_t* count, int* width, int* height)
+int parseTGA_RLE(const unsigned char* data, const size_t size, const struct ImageInfo* info, void* dst,
+                 const size_t stride)
 {
 	fprintf(stderr, "Not implemented yet!\n");
-	return NULL;
+	return 0;
 }
 
-struct Pixel* parsePNG_Grayscale(const unsigned char* data, const size_t size, size_t* count, int* width, int* height)
+int parsePNG_8bit(const unsigned char* data, const size_t size, const struct ImageInfo* info, void* dst,
+                  const size_t stride)
 {
-	fprintf(stderr, "Not implemented yet!\n");
-	return NULL;
+	return decodePNG(data, size, info, dst, stride, NULL);
 }
 
-struct Pixel* parsePNG_16bit(const unsigned char* data, const size_t size, size_t* count, int* width, int* height)
+int parsePNG_TRNS(const unsigned char* data, const size_t size, const struct ImageInfo* info, void* dst,
+                  const size_t stride)
 {
-	fprintf(stderr, "Not implemented yet!\n");
-	return NULL;
+	return decodePNG(data, size, info, dst, stride, NULL);
 }
 
-struct Pixel* parsePNG_ADAM7(const unsigned char* data, const size_t size, size_t* count, int* width, int* height)
+int parsePNG_PLTE(const unsigned char* data, const size_t size, const struct ImageInfo* info, void* dst,
+                  const size_t stride)
 {
-	fprintf(stderr, "Not implemented yet!\n");
-	return NULL;
+	return decodePNG(data, size, info, dst, stride, NULL);
+}
+
+int parsePNG_Grayscale(const unsigned char* data, const size_t size, const struct ImageInfo* info, void* dst,
+                       const size_t stride)
+{
+	return decodePNG(data, size, info, dst, stride, NULL);
+}
+
+int parsePNG_16bit(const unsigned char* data, const size_t size, const struct ImageInfo* info, void* dst,
+                   const size_t stride)
+{
+	return decodePNG(data, size, info, dst, stride, NULL);
+}
+
+int parsePNG_ADAM7(const unsigned char* data, const size_t size, const struct ImageInfo* info, void* dst,
+                   const size_t stride)
+{
+	return decodePNG(data, size, info, dst, stride, NULL);
 }
 
-struct Pixel* parseTIFF_Baseline(const unsigned char* data, const size_t size, size_t* count, int* width, int* height)
+int parseTIFF_Baseline(const unsigned char* data, const size_t size, const struct ImageInfo* info, void* dst,
+                       const size_t stride)
 {
 	fprintf(stderr, "Not implemented yet!\n");
-	return NULL;
+	return 0;
 }
 
-struct Pixel* parseJPEG_Baseline(const unsigned char* data, const size_t size, size_t* count, int* width, int* height)
+int parseJPEG_Baseline(const unsigned char* data, const size_t size, const struct ImageInfo* info, void* dst,
+                       const size_t stride)
 {
 	fprintf(stderr, "Not implemented yet!\n");
-	return NULL;
+	return 0;
 }
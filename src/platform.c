@@ -0,0 +1,458 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#define _XOPEN_SOURCE 700
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <sys/stat.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <glob.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#include "./include/platform.h"
+
+// Appends `dir` + `name` (either may be empty) to a growing path list
+static int appendPath(char*** list, int* count, int* capacity, const char* dir, const char* name)
+{
+	if (*count == *capacity)
+	{
+		const int grown = *capacity ? *capacity * 2 : 64;
+		char** larger = realloc(*list, (size_t)grown * sizeof(char*));
+		if (!larger) return 0;
+
+		*list = larger;
+		*capacity = grown;
+	}
+
+	const size_t dirLen = strlen(dir), nameLen = strlen(name);
+	char* path = malloc(dirLen + nameLen + 1);
+	if (!path) return 0;
+
+	memcpy(path, dir, dirLen);
+	memcpy(path + dirLen, name, nameLen + 1);
+	(*list)[(*count)++] = path;
+
+	return 1;
+}
+
+void freeFileList(char** paths, const int count)
+{
+	for (int i = 0; i < count; ++i) free(paths[i]);
+	free(paths);
+}
+
+#ifdef _WIN32
+static int mapHandle(HANDLE file, const size_t size, const int writable, struct MappedFile* out)
+{
+	const HANDLE mapping = CreateFileMappingA(file, NULL, writable ? PAGE_READWRITE : PAGE_WRITECOPY,
+	                                          (DWORD)((unsigned long long)size >> 32), (DWORD)size, NULL);
+	if (!mapping)
+	{
+		CloseHandle(file);
+		return 0;
+	}
+
+	void* data = MapViewOfFile(mapping, writable ? FILE_MAP_WRITE : FILE_MAP_COPY, 0, 0, size);
+	if (!data)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+
+		return 0;
+	}
+
+	out->data = data;
+	out->size = size;
+	out->file = file;
+	out->mapping = mapping;
+
+	return 1;
+}
+
+int mapFile(const char* path, struct MappedFile* out)
+{
+	if (!path || !out) return 0;
+	memset(out, 0, sizeof(*out));
+
+	const HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING,
+	                                FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE) return 0;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart <= 0)
+	{
+		CloseHandle(file);
+		return 0;
+	}
+
+	return mapHandle(file, (size_t)size.QuadPart, 0, out);
+}
+
+int createMappedFile(const char* path, const size_t size, struct MappedFile* out)
+{
+	if (!path || !out || !size) return 0;
+	memset(out, 0, sizeof(*out));
+
+	const HANDLE file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+	                                FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) return 0;
+
+	return mapHandle(file, size, 1, out);
+}
+
+int createTempMappedFile(const char* dir, const size_t size, struct MappedFile* out)
+{
+	if (!out || !size) return 0;
+	memset(out, 0, sizeof(*out));
+
+	char tempDir[MAX_PATH], path[MAX_PATH];
+	if (!dir)
+	{
+		if (!GetTempPathA(sizeof(tempDir), tempDir)) return 0;
+		dir = tempDir;
+	}
+	if (!GetTempFileNameA(dir, "ipd", 0, path)) return 0;
+
+	// Deleted once the mapping and the handle are closed, or when the process dies
+	const HANDLE file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_DELETE, NULL, CREATE_ALWAYS,
+	                                FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		DeleteFileA(path);
+		return 0;
+	}
+
+	return mapHandle(file, size, 1, out);
+}
+
+void unmapFile(struct MappedFile* file)
+{
+	if (!file || !file->data) return;
+
+	UnmapViewOfFile(file->data);
+	CloseHandle(file->mapping);
+	CloseHandle(file->file);
+	memset(file, 0, sizeof(*file));
+}
+
+int getFileStamp(const char* path, struct FileStamp* out)
+{
+	struct _stat64 st;
+	if (!path || !out || _stat64(path, &st) != 0) return 0;
+
+	out->mtime = (long long)st.st_mtime * 1000000000ll;
+	out->size = (unsigned long long)st.st_size;
+
+	return 1;
+}
+
+int getAbsolutePath(const char* path, char* out, const size_t outSize)
+{
+	return path && out && _fullpath(out, path, outSize) != NULL;
+}
+
+int replaceFile(const char* from, const char* to)
+{
+	return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
+unsigned long getProcessId(void)
+{
+	return (unsigned long)GetCurrentProcessId();
+}
+
+double getTime(void)
+{
+	LARGE_INTEGER counter, frequency;
+	QueryPerformanceCounter(&counter);
+	QueryPerformanceFrequency(&frequency);
+
+	return (double)counter.QuadPart / (double)frequency.QuadPart;
+}
+
+int getProcessorCount(void)
+{
+	SYSTEM_INFO si;
+	GetSystemInfo(&si);
+
+	return si.dwNumberOfProcessors > 0 ? (int)si.dwNumberOfProcessors : 1;
+}
+
+int isDirectory(const char* path)
+{
+	const DWORD attributes = path ? GetFileAttributesA(path) : INVALID_FILE_ATTRIBUTES;
+	return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+}
+
+int listFiles(const char* pattern, char*** out, int* count)
+{
+	if (!pattern || !out || !count) return 0;
+	*out = NULL;
+	*count = 0;
+
+	// FindFirstFile matches wildcards in the last component only and returns bare names, so keep the directory part
+	char search[MAX_PATH], dir[MAX_PATH];
+	const size_t len = strlen(pattern);
+	if (isDirectory(pattern))
+	{
+		const int slash = len && (pattern[len - 1] == '/' || pattern[len - 1] == '\\');
+		if (snprintf(search, sizeof(search), "%s%s*", pattern, slash ? "" : "\\") >= (int)sizeof(search)) return 0;
+	}
+	else if (snprintf(search, sizeof(search), "%s", pattern) >= (int)sizeof(search)) return 0;
+
+	size_t dirLen = strlen(search);
+	while (dirLen && search[dirLen - 1] != '/' && search[dirLen - 1] != '\\' && search[dirLen - 1] != ':') dirLen--;
+	memcpy(dir, search, dirLen);
+	dir[dirLen] = '\0';
+
+	WIN32_FIND_DATAA found;
+	const HANDLE find = FindFirstFileA(search, &found);
+	if (find == INVALID_HANDLE_VALUE) return 1;
+
+	int capacity = 0, ok = 1;
+	do
+	{
+		if (!(found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+			ok = appendPath(out, count, &capacity, dir, found.cFileName);
+	}
+	while (ok && FindNextFileA(find, &found));
+	FindClose(find);
+
+	if (!ok)
+	{
+		freeFileList(*out, *count);
+		*out = NULL;
+		*count = 0;
+	}
+	return ok;
+}
+#else
+int mapFile(const char* path, struct MappedFile* out)
+{
+	if (!path || !out) return 0;
+	memset(out, 0, sizeof(*out));
+
+	const int fd = open(path, O_RDONLY);
+	if (fd < 0) return 0;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size <= 0)
+	{
+		close(fd);
+		return 0;
+	}
+
+	void* data = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) return 0;
+
+	posix_madvise(data, (size_t)st.st_size, POSIX_MADV_WILLNEED);
+	out->data = data;
+	out->size = (size_t)st.st_size;
+
+	return 1;
+}
+
+int createMappedFile(const char* path, const size_t size, struct MappedFile* out)
+{
+	if (!path || !out || !size) return 0;
+	memset(out, 0, sizeof(*out));
+
+	const int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) return 0;
+
+	if (ftruncate(fd, (off_t)size) != 0)
+	{
+		close(fd);
+		return 0;
+	}
+
+	void* data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) return 0;
+
+	out->data = data;
+	out->size = size;
+
+	return 1;
+}
+
+int createTempMappedFile(const char* dir, const size_t size, struct MappedFile* out)
+{
+	if (!out || !size) return 0;
+	memset(out, 0, sizeof(*out));
+
+	if (!dir) dir = getenv("TMPDIR");
+	char path[PATH_MAX];
+	if (snprintf(path, sizeof(path), "%s/imageparser-XXXXXX", dir && *dir ? dir : "/tmp") >= (int)sizeof(path))
+		return 0;
+
+	const int fd = mkstemp(path);
+	if (fd < 0) return 0;
+	// The mapping keeps the space alive, so the file is unlinked right away and cannot outlive the process. The space
+	// is reserved up front so a full disk fails here instead of faulting on a later write.
+	unlink(path);
+	if (posix_fallocate(fd, 0, (off_t)size) != 0)
+	{
+		close(fd);
+		return 0;
+	}
+
+	void* data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) return 0;
+
+	out->data = data;
+	out->size = size;
+
+	return 1;
+}
+
+void unmapFile(struct MappedFile* file)
+{
+	if (!file || !file->data) return;
+
+	munmap(file->data, file->size);
+	memset(file, 0, sizeof(*file));
+}
+
+int getFileStamp(const char* path, struct FileStamp* out)
+{
+	struct stat st;
+	if (!path || !out || stat(path, &st) != 0) return 0;
+
+	out->mtime = (long long)st.st_mtim.tv_sec * 1000000000ll + (long long)st.st_mtim.tv_nsec;
+	out->size = (unsigned long long)st.st_size;
+
+	return 1;
+}
+
+int getAbsolutePath(const char* path, char* out, const size_t outSize)
+{
+	if (!path || !out || !outSize) return 0;
+
+	char* resolved = realpath(path, NULL);
+	if (!resolved) return 0;
+
+	const size_t len = strlen(resolved);
+	if (len >= outSize)
+	{
+		free(resolved);
+		return 0;
+	}
+
+	memcpy(out, resolved, len + 1);
+	free(resolved);
+
+	return 1;
+}
+
+int replaceFile(const char* from, const char* to)
+{
+	return rename(from, to) == 0;
+}
+
+unsigned long getProcessId(void)
+{
+	return (unsigned long)getpid();
+}
+
+double getTime(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+int getProcessorCount(void)
+{
+	const long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return n > 0 ? (int)n : 1;
+}
+
+int isDirectory(const char* path)
+{
+	struct stat st;
+	return path && stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+static int listDirectory(const char* path, char*** out, int* count)
+{
+	DIR* dir = opendir(path);
+	if (!dir) return 0;
+
+	const size_t len = strlen(path);
+	char* prefix = malloc(len + 2);
+	if (!prefix)
+	{
+		closedir(dir);
+		return 0;
+	}
+	memcpy(prefix, path, len);
+	prefix[len] = '/';
+	prefix[len + (len && path[len - 1] == '/' ? 0 : 1)] = '\0';
+
+	int capacity = 0, ok = 1;
+	const struct dirent* entry;
+	while (ok && (entry = readdir(dir)))
+	{
+		if (entry->d_name[0] == '.') continue;
+		if (!appendPath(out, count, &capacity, prefix, entry->d_name))
+		{
+			ok = 0;
+			break;
+		}
+
+		struct stat st;
+		if (stat((*out)[*count - 1], &st) != 0 || !S_ISREG(st.st_mode)) free((*out)[--*count]);
+	}
+
+	closedir(dir);
+	free(prefix);
+	return ok;
+}
+
+int listFiles(const char* pattern, char*** out, int* count)
+{
+	if (!pattern || !out || !count) return 0;
+	*out = NULL;
+	*count = 0;
+
+	int ok = 1;
+	if (isDirectory(pattern)) ok = listDirectory(pattern, out, count);
+	else
+	{
+		glob_t matches;
+		const int result = glob(pattern, 0, NULL, &matches);
+		if (result == 0)
+		{
+			int capacity = 0;
+			for (size_t i = 0; ok && i < matches.gl_pathc; ++i)
+				ok = appendPath(out, count, &capacity, "", matches.gl_pathv[i]);
+			globfree(&matches);
+		}
+		else ok = result == GLOB_NOMATCH;
+	}
+
+	if (!ok)
+	{
+		freeFileList(*out, *count);
+		*out = NULL;
+		*count = 0;
+	}
+	return ok;
+}
+#endif
@@ -0,0 +1,731 @@
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "./include/renderer.h"
+#include "./include/budget.h"
+#include "./include/checksum.h"
+#include "./include/convert.h"
+#include "./include/inflate.h"
+#include "./include/png.h"
+
+static const unsigned char pngSignature[8] = {0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A};
+
+struct PNGChunk
+{
+	unsigned int length;
+	const unsigned char *type, *data;
+};
+
+static unsigned int readBE32(const unsigned char* p)
+{
+	return (unsigned int)p[0] << 24 | (unsigned int)p[1] << 16 | (unsigned int)p[2] << 8 | (unsigned int)p[3];
+}
+
+static int nextChunk(const unsigned char* data, const size_t size, size_t* offset, struct PNGChunk* chunk)
+{
+	if (*offset > size || size - *offset < 12) return 0;
+
+	const unsigned int length = readBE32(data + *offset);
+	if (length > size - *offset - 12) return 0;
+
+	chunk->length = length;
+	chunk->type = data + *offset + 4;
+	chunk->data = data + *offset + 8;
+	*offset += 12u + (size_t)length;
+
+	return 1;
+}
+
+static int isChunk(const struct PNGChunk* chunk, const char* type)
+{
+	return memcmp(chunk->type, type, 4) == 0;
+}
+
+// Critical chunks have an uppercase first letter; CHECKSUM_CRITICAL leaves the ancillary ones unchecked
+static int wantsCRC(const enum ChecksumPolicy policy, const struct PNGChunk* chunk)
+{
+	return policy == CHECKSUM_FULL || (policy == CHECKSUM_CRITICAL && !(chunk->type[0] & 0x20));
+}
+
+// The CRC covers the type and data, which sit back to back, and is stored right after them
+static int checkCRC(const enum ChecksumPolicy policy, const struct PNGChunk* chunk)
+{
+	if (!wantsCRC(policy, chunk)) return 1;
+
+	const unsigned int stored = readBE32(chunk->data + chunk->length);
+	const unsigned int crc = updateCRC32(0, chunk->type, 4 + (size_t)chunk->length);
+	if (crc == stored) return 1;
+
+	fprintf(stderr, "Corrupt PNG: %.4s chunk CRC is %08X, expected %08X\n", (const char*)chunk->type, crc, stored);
+	return 0;
+}
+
+static int getChannels(const int colorType)
+{
+	switch (colorType)
+	{
+		case 0:
+		case 3:
+			return 1;
+		case 2:
+			return 3;
+		case 4:
+			return 2;
+		case 6:
+			return 4;
+		default:
+			return 0;
+	}
+}
+
+static int isValidDepth(const int colorType, const int bitDepth)
+{
+	switch (colorType)
+	{
+		case 0:
+			return bitDepth == 1 || bitDepth == 2 || bitDepth == 4 || bitDepth == 8 || bitDepth == 16;
+		case 3:
+			return bitDepth == 1 || bitDepth == 2 || bitDepth == 4 || bitDepth == 8;
+		case 2:
+		case 4:
+		case 6:
+			return bitDepth == 8 || bitDepth == 16;
+		default:
+			return 0;
+	}
+}
+
+int readPNGHeader(const unsigned char* data, const size_t size, struct ImageInfo* info)
+{
+	if (size < 8 || memcmp(data, pngSignature, sizeof(pngSignature)) != 0)
+	{
+		fprintf(stderr, "Invalid header: expected PNG signature\n");
+		return 0;
+	}
+
+	size_t offset = 8;
+	unsigned int gamma = 0;
+	int srgb = 0;
+	struct PNGChunk chunk;
+	if (!nextChunk(data, size, &offset, &chunk) || !isChunk(&chunk, "IHDR") || chunk.length != 13)
+	{
+		fprintf(stderr, "Invalid header: expected IHDR\n");
+		return 0;
+	}
+	if (!checkCRC(info->checksums, &chunk)) return 0;
+
+	const unsigned int w = readBE32(chunk.data), h = readBE32(chunk.data + 4);
+	const int bitDepth = chunk.data[8], colorType = chunk.data[9], interlace = chunk.data[12];
+	if (w == 0 || h == 0 || w > INT_MAX || h > INT_MAX)
+	{
+		fprintf(stderr, "Invalid image dimensions: %u x %u\n", w, h);
+		return 0;
+	}
+	if (!isValidDepth(colorType, bitDepth) || chunk.data[10] != 0 || chunk.data[11] != 0 || interlace > 1)
+	{
+		fprintf(stderr, "Invalid header: bit depth %d, color type %d, compression %d, filter %d, interlace %d\n",
+		        bitDepth, colorType, chunk.data[10], chunk.data[11], interlace);
+		return 0;
+	}
+
+	info->width = (int)w;
+	info->height = (int)h;
+	info->bitDepth = bitDepth;
+	info->colorType = colorType;
+	info->interlace = interlace;
+	info->maxVal = (1 << bitDepth) - 1;
+
+	for (int i = 0; i < 256; ++i)
+	{
+		info->palette[i][0] = info->palette[i][1] = info->palette[i][2] = 0;
+		info->palette[i][3] = 255;
+	}
+
+	for (;;)
+	{
+		const size_t chunkOffset = offset;
+		if (!nextChunk(data, size, &offset, &chunk) || isChunk(&chunk, "IEND"))
+		{
+			fprintf(stderr, "Invalid PNG: missing IDAT\n");
+			return 0;
+		}
+
+		if (isChunk(&chunk, "IDAT"))
+		{
+			info->dataOffset = chunkOffset;
+			break;
+		}
+		if (!checkCRC(info->checksums, &chunk)) return 0;
+
+		if (isChunk(&chunk, "PLTE"))
+		{
+			if (chunk.length % 3 != 0 || chunk.length == 0 || chunk.length > 256 * 3)
+			{
+				fprintf(stderr, "Invalid PNG: PLTE has %u bytes\n", chunk.length);
+				return 0;
+			}
+
+			info->paletteSize = (int)(chunk.length / 3);
+			for (int i = 0; i < info->paletteSize; ++i)
+				memcpy(info->palette[i], chunk.data + 3 * i, 3);
+		}
+		else if (isChunk(&chunk, "tRNS") && colorType == 3)
+		{
+			if (chunk.length > (unsigned int)info->paletteSize)
+			{
+				fprintf(stderr, "Invalid PNG: tRNS has more entries than PLTE\n");
+				return 0;
+			}
+
+			for (unsigned int i = 0; i < chunk.length; ++i) info->palette[i][3] = chunk.data[i];
+		}
+		else if (isChunk(&chunk, "gAMA") && chunk.length == 4)
+			gamma = readBE32(chunk.data);
+		else if (isChunk(&chunk, "sRGB"))
+			srgb = 1;
+		else if (isChunk(&chunk, "acTL"))
+		{
+			const unsigned int frames = chunk.length == 8 ? readBE32(chunk.data) : 0;
+			if (frames == 0 || frames > INT_MAX)
+			{
+				fprintf(stderr, "Invalid PNG: acTL has %u bytes, %u frames\n", chunk.length, frames);
+				return 0;
+			}
+
+			info->frameCount = (int)frames;
+			info->loopCount = (int)(readBE32(chunk.data + 4) & INT_MAX);
+		}
+		else if (isChunk(&chunk, "tRNS") && (colorType == 0 || colorType == 2))
+		{
+			const unsigned int samples = colorType == 0 ? 1 : 3;
+			if (chunk.length != 2 * samples)
+			{
+				fprintf(stderr, "Invalid PNG: tRNS has %u bytes\n", chunk.length);
+				return 0;
+			}
+
+			info->hasColorKey = 1;
+			for (unsigned int i = 0; i < samples; ++i)
+				info->colorKey[i] = (unsigned short)(chunk.data[2 * i] << 8 | chunk.data[2 * i + 1]);
+		}
+	}
+
+	if (colorType == 3 && !info->paletteSize)
+	{
+		fprintf(stderr, "Invalid PNG: missing PLTE\n");
+		return 0;
+	}
+
+	// sRGB wins over gAMA, and a gAMA close enough to sRGB's 1/2.2 is treated as sRGB so the rows stay on the copy path.
+	// Palette images are corrected once in the palette instead of per pixel.
+	if (!srgb && gamma && (gamma < 44000 || gamma > 47000)) info->gamma = (float)gamma / 100000.0f;
+	if (colorType == 3)
+	{
+		if (!applyPaletteTransfer(info->palette, info->paletteSize, info->gamma)) return 0;
+		info->gamma = 0.0f;
+	}
+
+	// Only a color key forces an alpha channel the file does not store
+	const int wide = bitDepth == 16, alpha = colorType == 4 || colorType == 6 || info->hasColorKey;
+	if (colorType == 3) info->nativeFormat = PIXEL_FORMAT_INDEX8;
+	else if (alpha) info->nativeFormat = wide ? PIXEL_FORMAT_RGBA16 : PIXEL_FORMAT_RGBA8;
+	else if (colorType == 0) info->nativeFormat = wide ? PIXEL_FORMAT_GRAY16 : PIXEL_FORMAT_GRAY8;
+	else info->nativeFormat = wide ? PIXEL_FORMAT_RGB16 : PIXEL_FORMAT_RGB8;
+
+	return 1;
+}
+
+// Consecutive IDAT chunks form one zlib stream; a lone IDAT (the common case) is used in place without copying. APNG
+// frames are gathered the same way from their fdAT chunks, minus the sequence number each one starts with. Chunk CRCs
+// are checked as each one is copied, while it is in cache.
+static const unsigned char* gatherImageData(const unsigned char* data, const size_t size, const size_t dataOffset,
+                                            const enum ChecksumPolicy policy, size_t* outSize, unsigned char** owned)
+{
+	size_t offset = dataOffset, total = 0, chunks = 0;
+	struct PNGChunk chunk, first = {0};
+
+	*owned = NULL;
+	if (!nextChunk(data, size, &offset, &chunk))
+	{
+		fprintf(stderr, "Invalid PNG: missing image data\n");
+		return NULL;
+	}
+
+	const char* type = isChunk(&chunk, "fdAT") ? "fdAT" : "IDAT";
+	const unsigned int skip = *type == 'f' ? 4 : 0;
+
+	offset = dataOffset;
+	while (nextChunk(data, size, &offset, &chunk) && isChunk(&chunk, type))
+	{
+		if (chunk.length < skip)
+		{
+			fprintf(stderr, "Invalid APNG: fdAT has %u bytes\n", chunk.length);
+			return NULL;
+		}
+		if (!chunks++) first = chunk;
+		total += chunk.length - skip;
+	}
+
+	*outSize = total;
+	if (chunks == 1) return checkCRC(policy, &first) ? first.data + skip : NULL;
+
+	unsigned char* joined = malloc(total ? total : 1);
+	if (!joined)
+	{
+		fprintf(stderr, "Failed to allocate memory for PNG image data\n");
+		return NULL;
+	}
+
+	offset = dataOffset;
+	size_t at = 0;
+	while (nextChunk(data, size, &offset, &chunk) && isChunk(&chunk, type))
+	{
+		memcpy(joined + at, chunk.data + skip, chunk.length - skip);
+		at += chunk.length - skip;
+		if (!checkCRC(policy, &chunk))
+		{
+			free(joined);
+			return NULL;
+		}
+	}
+
+	*owned = joined;
+	return joined;
+}
+
+static unsigned char paeth(const int a, const int b, const int c)
+{
+	const int p = a + b - c;
+	const int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+
+	if (pa <= pb && pa <= pc) return (unsigned char)a;
+	if (pb <= pc) return (unsigned char)b;
+	return (unsigned char)c;
+}
+
+static int unfilterRow(unsigned char* row, const unsigned char* prev, const size_t rowBytes, const size_t bpp,
+                       const int filter)
+{
+	switch (filter)
+	{
+		case 0:
+			return 1;
+		case 1:
+			for (size_t i = bpp; i < rowBytes; ++i) row[i] = (unsigned char)(row[i] + row[i - bpp]);
+			return 1;
+		case 2:
+			for (size_t i = 0; i < rowBytes; ++i) row[i] = (unsigned char)(row[i] + prev[i]);
+			return 1;
+		case 3:
+			for (size_t i = 0; i < bpp && i < rowBytes; ++i) row[i] = (unsigned char)(row[i] + (prev[i] >> 1));
+			for (size_t i = bpp; i < rowBytes; ++i)
+				row[i] = (unsigned char)(row[i] + ((row[i - bpp] + prev[i]) >> 1));
+			return 1;
+		case 4:
+			for (size_t i = 0; i < bpp && i < rowBytes; ++i) row[i] = (unsigned char)(row[i] + prev[i]);
+			for (size_t i = bpp; i < rowBytes; ++i)
+				row[i] = (unsigned char)(row[i] + paeth(row[i - bpp], prev[i], prev[i - bpp]));
+			return 1;
+		default:
+			fprintf(stderr, "Invalid PNG filter type: %d\n", filter);
+			return 0;
+	}
+}
+
+static enum RowLayout getRowLayout(const struct ImageInfo* info)
+{
+	const int wide = info->bitDepth == 16;
+	switch (info->colorType)
+	{
+		case 0:
+			switch (info->bitDepth)
+			{
+				case 1:
+					return ROW_LAYOUT_GRAY1;
+				case 2:
+					return ROW_LAYOUT_GRAY2;
+				case 4:
+					return ROW_LAYOUT_GRAY4;
+				default:
+					return wide ? ROW_LAYOUT_GRAY16 : ROW_LAYOUT_GRAY8;
+			}
+		case 2:
+			return wide ? ROW_LAYOUT_RGB16 : ROW_LAYOUT_RGB8;
+		case 3:
+			switch (info->bitDepth)
+			{
+				case 1:
+					return ROW_LAYOUT_INDEX1;
+				case 2:
+					return ROW_LAYOUT_INDEX2;
+				case 4:
+					return ROW_LAYOUT_INDEX4;
+				default:
+					return ROW_LAYOUT_INDEX8;
+			}
+		case 4:
+			return wide ? ROW_LAYOUT_GRAYA16 : ROW_LAYOUT_GRAYA8;
+		default:
+			return wide ? ROW_LAYOUT_RGBA16 : ROW_LAYOUT_RGBA8;
+	}
+}
+
+static unsigned int readSample(const unsigned char* row, const int bitDepth, const size_t i)
+{
+	switch (bitDepth)
+	{
+		case 16:
+			return (unsigned int)row[2 * i] << 8 | row[2 * i + 1];
+		case 8:
+			return row[i];
+		default:
+		{
+			const size_t bit = i * (size_t)bitDepth;
+			return (unsigned int)row[bit >> 3] >> (8 - bitDepth - (bit & 7)) & ((1u << bitDepth) - 1u);
+		}
+	}
+}
+
+// Clears alpha for pixels matching the tRNS color key; formats without an alpha channel keep the key color as is.
+static void applyColorKey(const unsigned char* src, void* dst, const int width, const struct ImageInfo* info)
+{
+	const size_t samples = info->colorType == 2 ? 3 : 1;
+	for (int x = 0; x < width; ++x)
+	{
+		size_t c = 0;
+		while (c < samples && readSample(src, info->bitDepth, (size_t)x * samples + c) == info->colorKey[c]) c++;
+		if (c < samples) continue;
+
+		switch (info->format)
+		{
+			case PIXEL_FORMAT_POINT:
+				((struct Pixel*)dst)[x].a = 0.0f;
+				break;
+			case PIXEL_FORMAT_RGBA8:
+				((unsigned char*)dst)[4 * (size_t)x + 3] = 0;
+				break;
+			case PIXEL_FORMAT_RGBA16:
+				((unsigned short*)dst)[4 * (size_t)x + 3] = 0;
+				break;
+			case PIXEL_FORMAT_RGBA32F:
+				((float*)dst)[4 * (size_t)x + 3] = 0.0f;
+				break;
+			default:
+				return;
+		}
+	}
+}
+
+// Adam7 pass origins and steps, plus the block each pass pixel covers while later passes are still missing
+static const struct
+{
+	int x0, y0, dx, dy, bw, bh;
+} adam7[7] = {
+	{0, 0, 8, 8, 8, 8}, {4, 0, 8, 8, 4, 8}, {0, 4, 4, 8, 4, 4}, {2, 0, 4, 4, 2, 4}, {0, 2, 2, 4, 2, 2},
+	{1, 0, 2, 2, 1, 2}, {0, 1, 1, 2, 1, 1}
+};
+
+// Rows are unfiltered and converted as soon as the inflater has produced them. Filtered rows are copied out of the
+// inflate buffer first, since later back-references still read the original bytes.
+struct PNGDecoder
+{
+	const struct ImageInfo* info;
+	unsigned char* dst;
+	size_t stride, pixelSize, bitsPerPixel, bpp;
+	const struct RowSink* sink;
+	struct RowConversion conversion;
+	const unsigned char* raw;
+	size_t consumed;
+	int pass, passes, passY, passWidth, passHeight;
+	size_t rowBytes;
+	unsigned char *cur, *prev, *passRow;
+};
+
+static void startPass(struct PNGDecoder* d)
+{
+	const struct ImageInfo* info = d->info;
+	for (; d->pass < d->passes; ++d->pass)
+	{
+		if (d->passes == 1)
+		{
+			d->passWidth = info->width;
+			d->passHeight = info->height;
+		}
+		else
+		{
+			const int x0 = adam7[d->pass].x0, y0 = adam7[d->pass].y0, dx = adam7[d->pass].dx, dy = adam7[d->pass].dy;
+			d->passWidth = info->width > x0 ? (info->width - x0 + dx - 1) / dx : 0;
+			d->passHeight = info->height > y0 ? (info->height - y0 + dy - 1) / dy : 0;
+		}
+		if (!d->passWidth || !d->passHeight) continue;
+
+		d->passY = 0;
+		d->rowBytes = ((size_t)d->passWidth * d->bitsPerPixel + 7) / 8;
+		memset(d->prev, 0, d->rowBytes);
+		return;
+	}
+}
+
+static void fixPointRow(struct Pixel* row, const int y, const int width)
+{
+	for (int x = 0; x < width; ++x)
+	{
+		row[x].x = (float)x;
+		row[x].y = (float)y;
+	}
+}
+
+// Writes one converted pass row into the image. With a sink attached each pass pixel is replicated over the block
+// that later passes will refine, so every published pass is a complete, coarser image.
+static int storePassRow(const struct PNGDecoder* d, const unsigned char* row)
+{
+	const struct ImageInfo* info = d->info;
+	const int replicate = d->sink != NULL;
+	const int x0 = adam7[d->pass].x0, dx = adam7[d->pass].dx;
+	const int bw = replicate ? adam7[d->pass].bw : 1, bh = replicate ? adam7[d->pass].bh : 1;
+	const int y = adam7[d->pass].y0 + d->passY * adam7[d->pass].dy;
+	const int rows = y + bh <= info->height ? bh : info->height - y;
+
+	unsigned char* out = d->dst + (size_t)y * d->stride;
+	for (int i = 0; i < d->passWidth; ++i)
+	{
+		const int x = x0 + i * dx, columns = x + bw <= info->width ? bw : info->width - x;
+		for (int c = 0; c < columns; ++c)
+			memcpy(out + (size_t)(x + c) * d->pixelSize, row + (size_t)i * d->pixelSize, d->pixelSize);
+	}
+
+	// Within a block band every row holds the same values up to this pass, so whole rows can be copied down
+	const size_t used = (size_t)info->width * d->pixelSize;
+	for (int r = 1; r < rows; ++r) memcpy(out + (size_t)r * d->stride, out, used);
+
+	if (info->format == PIXEL_FORMAT_POINT)
+		for (int r = 0; r < rows; ++r) fixPointRow((struct Pixel*)(out + (size_t)r * d->stride), y + r, info->width);
+
+	return rows;
+}
+
+static int consumeRows(struct PNGDecoder* d, const size_t produced)
+{
+	const struct ImageInfo* info = d->info;
+	while (d->pass < d->passes && produced - d->consumed >= d->rowBytes + 1)
+	{
+		const unsigned char* filtered = d->raw + d->consumed;
+		memcpy(d->cur, filtered + 1, d->rowBytes);
+		if (!unfilterRow(d->cur, d->prev, d->rowBytes, d->bpp, filtered[0])) return 0;
+		d->consumed += d->rowBytes + 1;
+
+		if (d->sink) d->sink->beginRows(d->sink->user);
+
+		int y, rows;
+		if (d->passes == 1)
+		{
+			y = d->passY;
+			rows = 1;
+
+			unsigned char* out = d->dst + (size_t)y * d->stride;
+			d->conversion.ctx.y = y;
+			d->conversion.convert(d->cur, out, info->width, &d->conversion.ctx);
+			if (info->hasColorKey) applyColorKey(d->cur, out, info->width, info);
+		}
+		else
+		{
+			y = adam7[d->pass].y0 + d->passY * adam7[d->pass].dy;
+
+			d->conversion.ctx.y = y;
+			d->conversion.convert(d->cur, d->passRow, d->passWidth, &d->conversion.ctx);
+			if (info->hasColorKey) applyColorKey(d->cur, d->passRow, d->passWidth, info);
+			rows = storePassRow(d, d->passRow);
+		}
+
+		if (d->sink && !d->sink->endRows(d->sink->user, y, rows)) return 0;
+
+		unsigned char* swap = d->prev;
+		d->prev = d->cur;
+		d->cur = swap;
+
+		if (++d->passY == d->passHeight)
+		{
+			d->pass++;
+			startPass(d);
+		}
+	}
+
+	return 1;
+}
+
+static int onInflateProgress(void* user, const size_t produced)
+{
+	return consumeRows(user, produced);
+}
+
+static size_t getInterlacedSize(const struct ImageInfo* info, const size_t bitsPerPixel)
+{
+	size_t total = 0;
+	for (int p = 0; p < 7; ++p)
+	{
+		const int w = info->width > adam7[p].x0 ? (info->width - adam7[p].x0 + adam7[p].dx - 1) / adam7[p].dx : 0;
+		const int h = info->height > adam7[p].y0 ? (info->height - adam7[p].y0 + adam7[p].dy - 1) / adam7[p].dy : 0;
+		if (w && h) total += (((size_t)w * bitsPerPixel + 7) / 8 + 1) * (size_t)h;
+	}
+
+	return total;
+}
+
+// The whole inflated stream, filter bytes included, or 0 when the image is empty or does not fit in memory at all
+static size_t getRawSize(const struct ImageInfo* info, const size_t bitsPerPixel)
+{
+	if (info->width <= 0 || info->height <= 0) return 0;
+	const size_t rowBytes = ((size_t)info->width * bitsPerPixel + 7) / 8;
+	if (rowBytes + 1 > SIZE_MAX / 2 / (size_t)info->height) return 0;
+
+	return info->interlace ? getInterlacedSize(info, bitsPerPixel) : (rowBytes + 1) * (size_t)info->height;
+}
+
+size_t getPNGScratchSize(const struct ImageInfo* info)
+{
+	const size_t bitsPerPixel = (size_t)getChannels(info->colorType) * (size_t)info->bitDepth;
+	const size_t rawSize = getRawSize(info, bitsPerPixel);
+
+	return rawSize ? rawSize + 2 * (((size_t)info->width * bitsPerPixel + 7) / 8) : SIZE_MAX;
+}
+
+int decodePNG(const unsigned char* data, const size_t size, const struct ImageInfo* info, void* dst,
+              const size_t stride, const struct RowSink* sink)
+{
+	struct PNGDecoder d;
+	memset(&d, 0, sizeof(d));
+	d.info = info;
+	d.dst = dst;
+	d.stride = stride;
+	d.sink = sink;
+	d.pixelSize = getPixelFormatSize(info->format);
+	d.bitsPerPixel = (size_t)getChannels(info->colorType) * (size_t)info->bitDepth;
+	d.bpp = d.bitsPerPixel >= 8 ? d.bitsPerPixel / 8 : 1;
+	d.passes = info->interlace ? 7 : 1;
+
+	const size_t rowBytes = ((size_t)info->width * d.bitsPerPixel + 7) / 8, rawSize = getRawSize(info, d.bitsPerPixel);
+	if (!rawSize)
+	{
+		fprintf(stderr, "Image too large: %dx%d exceeds maximum pixel count\n", info->width, info->height);
+		return 0;
+	}
+
+	size_t compressedSize = 0;
+	unsigned char* owned;
+	const unsigned char* compressed = gatherImageData(data, size, info->dataOffset, info->checksums, &compressedSize,
+	                                                    &owned);
+	// Out of core the inflated stream is spilled next to the output; it is written and consumed front to back
+	struct DecodeBuffer rawBuffer;
+	unsigned char* raw = allocDecodeBuffer(rawSize, info->outOfCore, &rawBuffer);
+	d.raw = raw;
+	d.cur = malloc(rowBytes ? rowBytes : 1);
+	d.prev = malloc(rowBytes ? rowBytes : 1);
+	d.passRow = info->interlace ? malloc((size_t)info->width * d.pixelSize) : NULL;
+
+	const unsigned int maxVal = info->colorType == 3 ? 255u : (unsigned int)info->maxVal;
+	int ok = compressed && raw && d.cur && d.prev && (d.passRow || !info->interlace);
+	if (!ok)
+	{
+		// A missing stream has been reported by gatherImageData already
+		if (compressed) fprintf(stderr, "Failed to allocate memory for PNG image data\n");
+	}
+	else ok = initRowConversion(&d.conversion, getRowLayout(info), info->format, maxVal, info->gamma);
+
+	if (ok)
+	{
+		d.conversion.ctx.palette = (const unsigned char (*)[4])info->palette;
+		startPass(&d);
+
+		size_t produced = 0;
+		ok = inflateZlibProgressive(compressed, compressedSize, raw, rawSize, &produced,
+		                            info->checksums != CHECKSUM_NONE, onInflateProgress, &d) && consumeRows(&d, produced);
+		if (ok && (produced != rawSize || d.pass < d.passes))
+		{
+			fprintf(stderr, "Truncated PNG image data: %zu of %zu bytes\n", produced, rawSize);
+			ok = 0;
+		}
+
+		freeRowConversion(&d.conversion);
+	}
+
+	free(d.passRow);
+	free(d.prev);
+	free(d.cur);
+	freeDecodeBuffer(&rawBuffer);
+	free(owned);
+
+	return ok;
+}
+
+// Collects the fcTL of every frame together with the offset of its first IDAT or fdAT chunk
+int readPNGFrames(const unsigned char* data, const size_t size, const struct ImageInfo* info, struct PNGFrame* frames)
+{
+	size_t offset = 8;
+	int count = 0, open = 0;
+	struct PNGChunk chunk;
+	while (count < info->frameCount || open)
+	{
+		const size_t chunkOffset = offset;
+		if (!nextChunk(data, size, &offset, &chunk) || isChunk(&chunk, "IEND")) break;
+
+		if (isChunk(&chunk, "fcTL"))
+		{
+			if (open || count == info->frameCount || chunk.length != 26)
+			{
+				fprintf(stderr, "Invalid APNG: unexpected fcTL\n");
+				return 0;
+			}
+			if (!checkCRC(info->checksums, &chunk)) return 0;
+
+			const unsigned char* c = chunk.data;
+			const unsigned int w = readBE32(c + 4), h = readBE32(c + 8), x = readBE32(c + 12), y = readBE32(c + 16);
+			const unsigned int delayNum = (unsigned int)(c[20] << 8 | c[21]), delayDen = (unsigned int)(c[22] << 8 | c[23]);
+			if (w == 0 || h == 0 || x > (unsigned int)info->width || w > (unsigned int)info->width - x ||
+				y > (unsigned int)info->height || h > (unsigned int)info->height - y || c[24] > 2 || c[25] > 1 ||
+				(count == 0 && (x || y || w != (unsigned int)info->width || h != (unsigned int)info->height)))
+			{
+				fprintf(stderr, "Invalid APNG: frame %d is %ux%u at %u,%u, dispose %d, blend %d\n", count, w, h, x, y,
+				        c[24], c[25]);
+				return 0;
+			}
+
+			struct PNGFrame* f = &frames[count];
+			f->x = (int)x;
+			f->y = (int)y;
+			f->width = (int)w;
+			f->height = (int)h;
+			f->delay = (double)delayNum / (double)(delayDen ? delayDen : 100);
+			// The previous canvas does not exist yet for the first frame, so it is cleared like the background
+			f->dispose = count == 0 && c[24] == PNG_DISPOSE_PREVIOUS ? PNG_DISPOSE_BACKGROUND : c[24];
+			f->blend = c[25];
+			open = 1;
+		}
+		else if (open && (isChunk(&chunk, "IDAT") || isChunk(&chunk, "fdAT")))
+		{
+			frames[count++].dataOffset = chunkOffset;
+			open = 0;
+		}
+	}
+
+	if (count != info->frameCount)
+	{
+		fprintf(stderr, "Invalid APNG: found %d of %d frames\n", count, info->frameCount);
+		return 0;
+	}
+
+	return 1;
+}
+
+int decodePNGFrame(const unsigned char* data, const size_t size, const struct ImageInfo* info,
+                   const struct PNGFrame* frame, void* dst, const size_t stride, const struct RowSink* sink)
+{
+	struct ImageInfo frameInfo = *info;
+	frameInfo.width = frame->width;
+	frameInfo.height = frame->height;
+	frameInfo.dataOffset = frame->dataOffset;
+
+	return decodePNG(data, size, &frameInfo, dst, stride, sink);
+}
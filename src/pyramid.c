@@ -0,0 +1,219 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define PYRAMID_SSE2 1
+#endif
+
+#include "./include/pyramid.h"
+
+static int getChannelCount(const enum PixelFormat format)
+{
+	switch (format)
+	{
+		case PIXEL_FORMAT_GRAY8:
+		case PIXEL_FORMAT_GRAY16:
+			return 1;
+		case PIXEL_FORMAT_RGB8:
+		case PIXEL_FORMAT_RGB16:
+			return 3;
+		case PIXEL_FORMAT_RGBA8:
+		case PIXEL_FORMAT_RGBA16:
+		case PIXEL_FORMAT_RGBA32F:
+			return 4;
+		default:
+			return 0;
+	}
+}
+
+// Palette indices cannot be averaged and point sprites are never tiled
+int canBuildPyramid(const enum PixelFormat format)
+{
+	return getChannelCount(format) != 0;
+}
+
+// Vertical half of the box filter: sums two source rows into 16-bit lanes, sixteen samples per step
+static void sumRows8(const unsigned char* a, const unsigned char* b, uint16_t* sums, const size_t count)
+{
+	size_t i = 0;
+#ifdef PYRAMID_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	for (; i + 16 <= count; i += 16)
+	{
+		const __m128i va = _mm_loadu_si128((const __m128i*)(a + i)), vb = _mm_loadu_si128((const __m128i*)(b + i));
+		_mm_storeu_si128((__m128i*)(sums + i),
+		                 _mm_add_epi16(_mm_unpacklo_epi8(va, zero), _mm_unpacklo_epi8(vb, zero)));
+		_mm_storeu_si128((__m128i*)(sums + i + 8),
+		                 _mm_add_epi16(_mm_unpackhi_epi8(va, zero), _mm_unpackhi_epi8(vb, zero)));
+	}
+#endif
+	for (; i < count; ++i) sums[i] = (uint16_t)(a[i] + b[i]);
+}
+
+static void sumRows16(const uint16_t* a, const uint16_t* b, uint32_t* sums, const size_t count)
+{
+	size_t i = 0;
+#ifdef PYRAMID_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	for (; i + 8 <= count; i += 8)
+	{
+		const __m128i va = _mm_loadu_si128((const __m128i*)(a + i)), vb = _mm_loadu_si128((const __m128i*)(b + i));
+		_mm_storeu_si128((__m128i*)(sums + i),
+		                 _mm_add_epi32(_mm_unpacklo_epi16(va, zero), _mm_unpacklo_epi16(vb, zero)));
+		_mm_storeu_si128((__m128i*)(sums + i + 4),
+		                 _mm_add_epi32(_mm_unpackhi_epi16(va, zero), _mm_unpackhi_epi16(vb, zero)));
+	}
+#endif
+	for (; i < count; ++i) sums[i] = (uint32_t)a[i] + b[i];
+}
+
+// Horizontal half: adds neighbouring pixels of the summed row; an odd last column is paired with itself
+static void reduceRow8(const uint16_t* sums, unsigned char* out, const int srcWidth, const int dstWidth,
+                       const int channels)
+{
+	for (int x = 0; x < dstWidth; ++x)
+	{
+		const uint16_t *p0 = sums + (size_t)2 * x * channels,
+		               *p1 = 2 * x + 1 < srcWidth ? p0 + channels : p0;
+		for (int c = 0; c < channels; ++c) out[(size_t)x * channels + c] = (unsigned char)((p0[c] + p1[c] + 2) >> 2);
+	}
+}
+
+static void reduceRow16(const uint32_t* sums, uint16_t* out, const int srcWidth, const int dstWidth,
+                        const int channels)
+{
+	for (int x = 0; x < dstWidth; ++x)
+	{
+		const uint32_t *p0 = sums + (size_t)2 * x * channels,
+		               *p1 = 2 * x + 1 < srcWidth ? p0 + channels : p0;
+		for (int c = 0; c < channels; ++c) out[(size_t)x * channels + c] = (uint16_t)((p0[c] + p1[c] + 2) >> 2);
+	}
+}
+
+static void reduceRowFloat(const float* a, const float* b, float* out, const int srcWidth, const int dstWidth,
+                           const int channels)
+{
+	for (int x = 0; x < dstWidth; ++x)
+	{
+		const size_t i0 = (size_t)2 * x * channels, i1 = 2 * x + 1 < srcWidth ? i0 + channels : i0;
+		for (int c = 0; c < channels; ++c)
+			out[(size_t)x * channels + c] = (a[i0 + c] + a[i1 + c] + b[i0 + c] + b[i1 + c]) * 0.25f;
+	}
+}
+
+static int downsample(const struct PyramidLevel* src, const struct PyramidLevel* dst, unsigned char* pixels,
+                      const enum PixelFormat format)
+{
+	const int channels = getChannelCount(format);
+	const size_t samples = (size_t)src->width * channels;
+	void* sums = malloc(samples * sizeof(uint32_t));
+	if (!sums) return 0;
+
+	for (int y = 0; y < dst->height; ++y)
+	{
+		const unsigned char* r0 = src->pixels + (size_t)2 * y * src->stride;
+		const unsigned char* r1 = 2 * y + 1 < src->height ? r0 + src->stride : r0;
+		unsigned char* out = pixels + (size_t)y * dst->stride;
+
+		switch (format)
+		{
+			case PIXEL_FORMAT_GRAY8:
+			case PIXEL_FORMAT_RGB8:
+			case PIXEL_FORMAT_RGBA8:
+				sumRows8(r0, r1, sums, samples);
+				reduceRow8(sums, out, src->width, dst->width, channels);
+				break;
+			case PIXEL_FORMAT_GRAY16:
+			case PIXEL_FORMAT_RGB16:
+			case PIXEL_FORMAT_RGBA16:
+				sumRows16((const uint16_t*)r0, (const uint16_t*)r1, sums, samples);
+				reduceRow16(sums, (uint16_t*)out, src->width, dst->width, channels);
+				break;
+			default:
+				reduceRowFloat((const float*)r0, (const float*)r1, (float*)out, src->width, dst->width, channels);
+				break;
+		}
+	}
+
+	free(sums);
+	return 1;
+}
+
+static void setLevelSize(struct PyramidLevel* level, const int width, const int height, const size_t pixelSize)
+{
+	level->width = width;
+	level->height = height;
+	level->tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+	level->tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+	level->stride = (size_t)width * pixelSize;
+}
+
+size_t getPyramidSize(const struct ImageInfo* info)
+{
+	const size_t pixelSize = getPixelFormatSize(info->format);
+	size_t total = 0;
+	int width = info->width, height = info->height;
+	for (int level = 1; level < PYRAMID_MAX_LEVELS && (width > TILE_SIZE || height > TILE_SIZE); ++level)
+	{
+		width = (width + 1) / 2;
+		height = (height + 1) / 2;
+		total += (size_t)width * pixelSize * (size_t)height;
+	}
+
+	return total;
+}
+
+int buildPyramid(struct Pyramid* out, const struct ImageInfo* info, const void* pixels)
+{
+	if (!out || !info || !pixels) return 0;
+	memset(out, 0, sizeof(*out));
+
+	if (!canBuildPyramid(info->format))
+	{
+		fprintf(stderr, "Pixel format %d cannot be tiled\n", (int)info->format);
+		return 0;
+	}
+
+	const size_t pixelSize = getPixelFormatSize(info->format);
+	out->info = *info;
+	out->levelCount = 1;
+	setLevelSize(&out->levels[0], info->width, info->height, pixelSize);
+	out->levels[0].stride = info->stride;
+	out->levels[0].pixels = pixels;
+
+	while (out->levelCount < PYRAMID_MAX_LEVELS)
+	{
+		const struct PyramidLevel* src = &out->levels[out->levelCount - 1];
+		if (src->width <= TILE_SIZE && src->height <= TILE_SIZE) break;
+
+		struct PyramidLevel* dst = &out->levels[out->levelCount];
+		setLevelSize(dst, (src->width + 1) / 2, (src->height + 1) / 2, pixelSize);
+		struct DecodeBuffer* buffer = &out->buffers[out->levelCount];
+		unsigned char* pixels = allocDecodeBuffer(dst->stride * (size_t)dst->height, info->outOfCore, buffer);
+		dst->pixels = pixels;
+		if (!pixels || !downsample(src, dst, pixels, info->format))
+		{
+			fprintf(stderr, "Failed to allocate mip level %d (%dx%d)\n", out->levelCount, dst->width, dst->height);
+			freeDecodeBuffer(buffer);
+			dst->pixels = NULL;
+			destroyPyramid(out);
+
+			return 0;
+		}
+
+		out->levelCount++;
+	}
+
+	return 1;
+}
+
+void destroyPyramid(struct Pyramid* pyramid)
+{
+	if (!pyramid) return;
+
+	for (int i = 1; i < pyramid->levelCount; ++i) freeDecodeBuffer(&pyramid->buffers[i]);
+	memset(pyramid, 0, sizeof(*pyramid));
+}
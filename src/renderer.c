@@ -1,3 +1,4 @@
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -7,10 +8,12 @@ static const char* vertexSource = "#version 330 core\n"
 	"layout(location = 0) in vec2 aPos;\n"
 	"layout(location = 1) in vec4 aColor;\n"
 	"layout(location = 2) in float aSize;\n"
+	"uniform vec3 uView;\n"
 	"out vec4 vColor;\n"
 	"void main()\n"
 	"{\n"
-	"    gl_Position = vec4(aPos, 0.0, 1.0);\n"
+	"    vec2 p = (uView.z + aPos * aSize) / uView.xy;\n"
+	"    gl_Position = vec4(p.x * 2.0 - 1.0, 1.0 - p.y * 2.0, 0.0, 1.0);\n"
 	"    vColor = aColor;\n"
 	"    gl_PointSize = aSize;\n"
 	"}\n";
@@ -23,16 +26,116 @@ static const char* fragmentSource = "#version 330 core\n"
 	"    FragColor = vColor;\n"
 	"}\n";
 
-extern struct Pixel* pixels;
-extern int imageWidth, imageHeight;
-extern size_t count;
+static const char* textureVertexSource = "#version 330 core\n"
+	"uniform vec3 uView;\n"
+	"uniform vec3 uImage;\n"
+	"out vec2 vTexel;\n"
+	"void main()\n"
+	"{\n"
+	"    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);\n"
+	"    vTexel = corner * uImage.xy;\n"
+	"    vec2 p = (uView.z + vTexel * uImage.z) / uView.xy;\n"
+	"    gl_Position = vec4(p.x * 2.0 - 1.0, 1.0 - p.y * 2.0, 0.0, 1.0);\n"
+	"}\n";
+
+static const char* paletteFragmentSource = "#version 330 core\n"
+	"in vec2 vTexel;\n"
+	"uniform usampler2D uImageTexture;\n"
+	"uniform sampler2D uPalette;\n"
+	"out vec4 FragColor;\n"
+	"void main()\n"
+	"{\n"
+	"    uint index = texelFetch(uImageTexture, ivec2(vTexel), 0).r;\n"
+	"    FragColor = texelFetch(uPalette, ivec2(int(index), 0), 0);\n"
+	"}\n";
+
+static const char* imageFragmentSource = "#version 330 core\n"
+	"in vec2 vTexel;\n"
+	"uniform sampler2D uImageTexture;\n"
+	"out vec4 FragColor;\n"
+	"void main()\n"
+	"{\n"
+	"    FragColor = texelFetch(uImageTexture, ivec2(vTexel), 0);\n"
+	"}\n";
+
+// Tiles are placed in level 0 image pixels; uCamera is (centerX, centerY, zoom) and uTileSize the texels of the
+// tile texture that are in use, which is less than TILE_SIZE along the right and bottom edges.
+static const char* tileVertexSource = "#version 330 core\n"
+	"uniform vec3 uView;\n"
+	"uniform vec3 uCamera;\n"
+	"uniform vec4 uTile;\n"
+	"uniform vec2 uTileSize;\n"
+	"out vec2 vTexel;\n"
+	"void main()\n"
+	"{\n"
+	"    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);\n"
+	"    vTexel = corner * uTileSize;\n"
+	"    vec2 image = uTile.xy + corner * uTile.zw;\n"
+	"    vec2 p = ((image - uCamera.xy) * uCamera.z + uView.xy * 0.5) / uView.xy;\n"
+	"    gl_Position = vec4(p.x * 2.0 - 1.0, 1.0 - p.y * 2.0, 0.0, 1.0);\n"
+	"}\n";
+
+struct TextureFormat
+{
+	GLint internalFormat;
+	GLenum format, type;
+	GLint swizzle[4];
+};
+
+// Gray formats are single-channel textures; the sampler swizzle broadcasts red so the shader sees an opaque gray.
+static const struct TextureFormat textureFormats[PIXEL_FORMAT_COUNT] = {
+	[PIXEL_FORMAT_RGB8] = {GL_RGB8, GL_RGB, GL_UNSIGNED_BYTE, {GL_RED, GL_GREEN, GL_BLUE, GL_ONE}},
+	[PIXEL_FORMAT_RGBA8] = {GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, {GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA}},
+	[PIXEL_FORMAT_RGBA32F] = {GL_RGBA32F, GL_RGBA, GL_FLOAT, {GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA}},
+	[PIXEL_FORMAT_INDEX8] = {GL_R8UI, GL_RED_INTEGER, GL_UNSIGNED_BYTE, {GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA}},
+	[PIXEL_FORMAT_GRAY8] = {GL_R8, GL_RED, GL_UNSIGNED_BYTE, {GL_RED, GL_RED, GL_RED, GL_ONE}},
+	[PIXEL_FORMAT_GRAY16] = {GL_R16, GL_RED, GL_UNSIGNED_SHORT, {GL_RED, GL_RED, GL_RED, GL_ONE}},
+	[PIXEL_FORMAT_RGB16] = {GL_RGB16, GL_RGB, GL_UNSIGNED_SHORT, {GL_RED, GL_GREEN, GL_BLUE, GL_ONE}},
+	[PIXEL_FORMAT_RGBA16] = {GL_RGBA16, GL_RGBA, GL_UNSIGNED_SHORT, {GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA}},
+};
+
+#define TILE_CACHE_BUDGET ((size_t)128 << 20)
+#define TILE_CACHE_MIN_SLOTS 16
+#define TILE_CACHE_MAX_SLOTS 512
+#define TILE_UPLOADS_PER_FRAME 16
+
+struct TileSlot
+{
+	GLuint texture;
+	int level, x, y;
+	unsigned long long lastUsed;
+};
+
+// Fixed pool of TILE_SIZE textures sized from TILE_CACHE_BUDGET; tiles are uploaded on first use and the least
+// recently drawn one is recycled once the pool is full.
+struct TileCache
+{
+	GLint uCamera, uTile, uTileSize;
+	unsigned long long frame;
+	int slotCount;
+	struct TileSlot slots[];
+};
+
 extern struct GLObjects gl;
 
+// Nothing is drawn unless something invalidated the frame: a resize, an expose, input or newly decoded rows
+static int frameInvalid = 1;
+static double frameStart;
+static struct FrameStats frameStats;
+
 // ReSharper disable once CppParameterMayBeConstPtrOrRef
 static void fbSizeCallback(GLFWwindow* window, const int width, const int height)
 {
 	(void)window;
 	updatePositions(width, height);
+	invalidateFrame();
+}
+
+// ReSharper disable once CppParameterMayBeConstPtrOrRef
+static void refreshCallback(GLFWwindow* window)
+{
+	(void)window;
+	invalidateFrame();
 }
 
 GLFWwindow* createWindow(const int w, const int h, const char* title)
@@ -59,6 +162,7 @@ GLFWwindow* createWindow(const int w, const int h, const char* title)
 
 	glfwMakeContextCurrent(window);
 	glfwSetFramebufferSizeCallback(window, fbSizeCallback);
+	glfwSetWindowRefreshCallback(window, refreshCallback);
 	glfwSwapInterval(1);
 
 	glEnable(GL_BLEND);
@@ -154,26 +258,63 @@ void setUniform3f(const GLuint program, const char* name, const float x, const f
 	glUseProgram(0);
 }
 
+static void setUniform1i(const GLuint program, const char* name, const int v)
+{
+	glUseProgram(program);
+	const GLint loc = glGetUniformLocation(program, name);
+	if (loc != -1)
+		glUniform1i(loc, v);
+	glUseProgram(0);
+}
+
 void updatePositions(const int fbW, const int fbH)
 {
 	glViewport(0, 0, fbW, fbH);
-	for (int row = 0; row < imageHeight; ++row)
-	{
-		for (int col = 0; col < imageWidth; ++col)
-		{
-			const size_t i = (size_t)row * (size_t)imageWidth + (size_t)col;
-			const float xPixels = PADDING + (float)col * PIXEL_SIZE;
-			const float yPixels = PADDING + (float)row * PIXEL_SIZE;
+	setUniform3f(gl.program, "uView", (float)fbW, (float)fbH, PADDING);
+}
 
-			pixels[i].x = xPixels / (float)fbW * 2.0f - 1.0f;
-			pixels[i].y = 1.0f - yPixels / (float)fbH * 2.0f;
-			pixels[i].size = PIXEL_SIZE;
-		}
-	}
+void invalidateFrame(void)
+{
+	frameInvalid = 1;
+}
 
-	glBindBuffer(GL_ARRAY_BUFFER, gl.VBO);
-	glBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr)(count * sizeof(struct Pixel)), pixels);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+int beginFrame(void)
+{
+	if (!frameInvalid) return 0;
+
+	frameInvalid = 0;
+	frameStart = glfwGetTime();
+	return 1;
+}
+
+void endFrame(GLFWwindow* window)
+{
+	glfwSwapBuffers(window);
+
+	const double elapsed = glfwGetTime() - frameStart;
+	frameStats.frames++;
+	frameStats.lastFrameTime = elapsed;
+	frameStats.totalFrameTime += elapsed;
+	if (elapsed > frameStats.maxFrameTime) frameStats.maxFrameTime = elapsed;
+}
+
+void waitForEvents(const int poll)
+{
+	if (poll) glfwPollEvents();
+	else glfwWaitEvents();
+	frameStats.wakeups++;
+}
+
+void waitForEventsTimeout(const double timeout)
+{
+	if (timeout > 0.0) glfwWaitEventsTimeout(timeout);
+	else glfwPollEvents();
+	frameStats.wakeups++;
+}
+
+const struct FrameStats* getFrameStats(void)
+{
+	return &frameStats;
 }
 
 int createObjects(struct GLObjects* out, const struct Pixel* pixelObjects, const size_t totalCount)
@@ -193,7 +334,7 @@ int createObjects(struct GLObjects* out, const struct Pixel* pixelObjects, const
 	glBindBuffer(GL_ARRAY_BUFFER, out->VBO);
 
 	const GLsizeiptr stride = 7 * sizeof(float);
-	if (pixelObjects && totalCount > 0)
+	if (totalCount > 0)
 		glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(totalCount * stride), pixelObjects, GL_STATIC_DRAW);
 	else
 		glBufferData(GL_ARRAY_BUFFER, stride, NULL, GL_STATIC_DRAW);
@@ -213,8 +354,483 @@ int createObjects(struct GLObjects* out, const struct Pixel* pixelObjects, const
 	return 1;
 }
 
+struct Pixel* mapObjects(const struct GLObjects* glObjects, const size_t totalCount)
+{
+	if (!glObjects || !glObjects->VBO || totalCount == 0) return NULL;
+
+	glBindBuffer(GL_ARRAY_BUFFER, glObjects->VBO);
+	struct Pixel* mapped = glMapBufferRange(GL_ARRAY_BUFFER, 0, (GLsizeiptr)(totalCount * sizeof(struct Pixel)),
+	                                        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	if (!mapped) fprintf(stderr, "Failed to map vertex buffer (GL error 0x%x)\n", glGetError());
+	return mapped;
+}
+
+int unmapObjects(const struct GLObjects* glObjects)
+{
+	if (!glObjects || !glObjects->VBO) return 0;
+
+	glBindBuffer(GL_ARRAY_BUFFER, glObjects->VBO);
+	const GLboolean ok = glUnmapBuffer(GL_ARRAY_BUFFER);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	if (!ok) fprintf(stderr, "Vertex buffer contents were lost while mapped\n");
+	return ok == GL_TRUE;
+}
+
+static GLuint createTexture(void)
+{
+	GLuint id = 0;
+	glGenTextures(1, &id);
+	glBindTexture(GL_TEXTURE_2D, id);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	return id;
+}
+
+// `pixels` points at pixel (x, y), or is an offset into the bound unpack buffer
+static void uploadTextureRect(const GLuint texture, const struct ImageInfo* info, const void* pixels, const int x,
+                              const int y, const int width, const int height)
+{
+	const struct TextureFormat* tf = &textureFormats[info->format];
+
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, (GLint)(info->stride / getPixelFormatSize(info->format)));
+	glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, tf->format, tf->type, pixels);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+static void uploadTexture(const GLuint texture, const struct ImageInfo* info, const void* pixels, const int y,
+                          const int count)
+{
+	uploadTextureRect(texture, info, pixels, 0, y, info->width, count);
+}
+
+// The image is uploaded in its native format, so gray and 16-bit data keep their size and precision on the GPU.
+// Palette images stay one byte per pixel as well; the fragment shader expands each index through a 256x1 RGBA
+// palette texture instead of the CPU widening every pixel to a struct Pixel.
+int createTextureObjects(struct GLObjects* out, const struct ImageInfo* info, const void* pixels)
+{
+	if (!info || (unsigned int)info->format >= PIXEL_FORMAT_COUNT || !textureFormats[info->format].internalFormat)
+	{
+		fprintf(stderr, "Unsupported texture pixel format: %d\n", info ? (int)info->format : -1);
+		return 0;
+	}
+
+	GLint maxSize = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+	if (info->width > maxSize || info->height > maxSize)
+	{
+		fprintf(stderr, "Image %dx%d exceeds the maximum texture size %d\n", info->width, info->height, maxSize);
+		return 0;
+	}
+
+	const int indexed = info->format == PIXEL_FORMAT_INDEX8;
+	const GLuint vs = compileShader(GL_VERTEX_SHADER, textureVertexSource);
+	const GLuint fs = compileShader(GL_FRAGMENT_SHADER, indexed ? paletteFragmentSource : imageFragmentSource);
+	if (!vs || !fs) return 0;
+
+	out->program = linkProgram(vs, fs);
+	glDeleteShader(vs);
+	glDeleteShader(fs);
+	if (!out->program) return 0;
+
+	glGenVertexArrays(1, &out->VAO);
+
+	const struct TextureFormat* tf = &textureFormats[info->format];
+	out->texture = createTexture();
+	glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, tf->swizzle);
+	glTexImage2D(GL_TEXTURE_2D, 0, tf->internalFormat, info->width, info->height, 0, tf->format, tf->type, NULL);
+	if (pixels) uploadTexture(out->texture, info, pixels, 0, info->height);
+
+	if (indexed)
+	{
+		out->palette = createTexture();
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 256, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, info->palette);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	setUniform3f(out->program, "uImage", (float)info->width, (float)info->height, PIXEL_SIZE);
+	setUniform1i(out->program, "uImageTexture", 0);
+	setUniform1i(out->program, "uPalette", 1);
+
+	return 1;
+}
+
+int updateTextureRows(const struct GLObjects* glObjects, const struct ImageInfo* info, const void* pixels,
+                      const int y, const int count)
+{
+	if (!glObjects || !glObjects->texture || !info || !pixels || y < 0 || count <= 0 || y + count > info->height)
+		return 0;
+
+	uploadTexture(glObjects->texture, info, (const unsigned char*)pixels + (size_t)y * info->stride, y, count);
+	return 1;
+}
+
+int updateTextureRect(const struct GLObjects* glObjects, const struct ImageInfo* info, const void* pixels, const int x,
+                      const int y, const int width, const int height)
+{
+	if (!glObjects || !glObjects->texture || !info || !pixels || x < 0 || y < 0 || width <= 0 || height <= 0 ||
+		x + width > info->width || y + height > info->height)
+		return 0;
+
+	const unsigned char* origin = (const unsigned char*)pixels + (size_t)y * info->stride +
+		(size_t)x * getPixelFormatSize(info->format);
+	uploadTextureRect(glObjects->texture, info, origin, x, y, width, height);
+	return 1;
+}
+
+// The slots live in one pixel buffer that stays mapped for the life of the ring (GL 4.4 / ARB_buffer_storage), so
+// the decoder thread writes straight into memory the GPU transfers from and the GL thread only issues
+// glTexSubImage2D from buffer offsets. A fence per slot tells when it may be refilled. Without buffer storage the slots
+// fall back to client memory, which the driver copies before glTexSubImage2D returns.
+struct UploadRing* createUploadRing(struct GLObjects* glObjects, const struct ImageInfo* info)
+{
+	if (!glObjects || !glObjects->texture || !info || !info->stride || glObjects->uploads) return NULL;
+
+	size_t slotRows = UPLOAD_SLOT_BYTES / info->stride;
+	if (slotRows < 1) slotRows = 1;
+	if (slotRows > (size_t)info->height) slotRows = (size_t)info->height;
+	const size_t size = slotRows * info->stride * UPLOAD_RING_SLOTS;
+
+	struct UploadRing* ring = calloc(1, sizeof(*ring));
+	if (!ring)
+	{
+		fprintf(stderr, "Failed to allocate upload ring\n");
+		return NULL;
+	}
+
+	GLuint buffer = 0;
+	unsigned char* memory = NULL;
+	if (GLEW_ARB_buffer_storage)
+	{
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glGenBuffers(1, &buffer);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+		glBufferStorage(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)size, NULL, flags);
+		memory = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)size, flags);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+		if (!memory)
+		{
+			fprintf(stderr, "Failed to map upload ring (GL error 0x%x), using client memory\n", glGetError());
+			glDeleteBuffers(1, &buffer);
+			buffer = 0;
+		}
+	}
+	if (!memory) memory = malloc(size);
+
+	if (!memory || !initUploadRing(ring, memory, buffer, info->stride, (int)slotRows))
+	{
+		fprintf(stderr, "Failed to allocate upload ring\n");
+		if (buffer) glDeleteBuffers(1, &buffer);
+		else free(memory);
+		free(ring);
+
+		return NULL;
+	}
+
+	glObjects->uploads = ring;
+	return ring;
+}
+
+int flushUploadRing(struct GLObjects* glObjects, const struct ImageInfo* info)
+{
+	struct UploadRing* ring = glObjects ? glObjects->uploads : NULL;
+	if (!ring || !info) return 0;
+
+	int busy = 0;
+	for (int i = 0; i < UPLOAD_RING_SLOTS; ++i)
+	{
+		struct UploadSlot* slot = &ring->slots[i];
+		if (!slot->fence) continue;
+
+		const GLenum status = glClientWaitSync((GLsync)slot->fence, 0, 0);
+		if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED)
+		{
+			glDeleteSync((GLsync)slot->fence);
+			slot->fence = NULL;
+			releaseUploadSlot(ring, slot);
+		}
+		else busy = 1;
+	}
+
+	int uploaded = 0;
+	struct UploadSlot* slot;
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ring->buffer);
+	while ((slot = takeReadySlot(ring)))
+	{
+		uploadTexture(glObjects->texture, info, ring->buffer ? (const void*)slot->offset : slot->data, slot->y,
+		              slot->count);
+		uploaded++;
+
+		if (ring->buffer)
+		{
+			slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			busy = 1;
+		}
+		else releaseUploadSlot(ring, slot);
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	if (uploaded)
+	{
+		glFlush();
+		invalidateFrame();
+	}
+	return busy;
+}
+
+// The producer must be stopped or the ring closed first
+void destroyUploadRing(struct GLObjects* glObjects)
+{
+	struct UploadRing* ring = glObjects ? glObjects->uploads : NULL;
+	if (!ring) return;
+
+	for (int i = 0; i < UPLOAD_RING_SLOTS; ++i)
+		if (ring->slots[i].fence) glDeleteSync((GLsync)ring->slots[i].fence);
+
+	unsigned char* memory = ring->memory;
+	freeUploadRing(ring);
+	if (ring->buffer)
+	{
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ring->buffer);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		glDeleteBuffers(1, &ring->buffer);
+	}
+	else free(memory);
+	free(ring);
+	glObjects->uploads = NULL;
+}
+
+void* mapTextureObjects(struct GLObjects* glObjects, const struct ImageInfo* info)
+{
+	if (!glObjects || !glObjects->texture || !info) return NULL;
+
+	if (!glObjects->PBO) glGenBuffers(1, &glObjects->PBO);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, glObjects->PBO);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)info->size, NULL, GL_STREAM_DRAW);
+	void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)info->size,
+	                                GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	if (!mapped) fprintf(stderr, "Failed to map pixel buffer (GL error 0x%x)\n", glGetError());
+	return mapped;
+}
+
+int unmapTextureObjects(struct GLObjects* glObjects, const struct ImageInfo* info)
+{
+	if (!glObjects || !glObjects->PBO || !info) return 0;
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, glObjects->PBO);
+	const GLboolean ok = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+	if (ok) uploadTexture(glObjects->texture, info, NULL, 0, info->height);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	glDeleteBuffers(1, &glObjects->PBO);
+	glObjects->PBO = 0;
+
+	if (!ok) fprintf(stderr, "Pixel buffer contents were lost while mapped\n");
+	return ok == GL_TRUE;
+}
+
+int createTileObjects(struct GLObjects* out, const struct Pyramid* pyramid)
+{
+	const enum PixelFormat format = pyramid ? pyramid->info.format : PIXEL_FORMAT_POINT;
+	if (!pyramid || !pyramid->levelCount || !canBuildPyramid(format) || !textureFormats[format].internalFormat)
+	{
+		fprintf(stderr, "Unsupported tile pixel format: %d\n", (int)format);
+		return 0;
+	}
+
+	const size_t tileBytes = (size_t)TILE_SIZE * TILE_SIZE * getPixelFormatSize(format);
+	size_t slotCount = TILE_CACHE_BUDGET / tileBytes;
+	if (slotCount < TILE_CACHE_MIN_SLOTS) slotCount = TILE_CACHE_MIN_SLOTS;
+	if (slotCount > TILE_CACHE_MAX_SLOTS) slotCount = TILE_CACHE_MAX_SLOTS;
+
+	struct TileCache* cache = calloc(1, sizeof(*cache) + slotCount * sizeof(struct TileSlot));
+	if (!cache)
+	{
+		fprintf(stderr, "Failed to allocate tile cache\n");
+		return 0;
+	}
+	cache->slotCount = (int)slotCount;
+	for (int i = 0; i < cache->slotCount; ++i) cache->slots[i].level = -1;
+	out->tiles = cache;
+
+	const GLuint vs = compileShader(GL_VERTEX_SHADER, tileVertexSource);
+	const GLuint fs = compileShader(GL_FRAGMENT_SHADER, imageFragmentSource);
+	if (!vs || !fs) return 0;
+
+	out->program = linkProgram(vs, fs);
+	glDeleteShader(vs);
+	glDeleteShader(fs);
+	if (!out->program) return 0;
+
+	glGenVertexArrays(1, &out->VAO);
+
+	cache->uCamera = glGetUniformLocation(out->program, "uCamera");
+	cache->uTile = glGetUniformLocation(out->program, "uTile");
+	cache->uTileSize = glGetUniformLocation(out->program, "uTileSize");
+	setUniform1i(out->program, "uImageTexture", 0);
+
+	return 1;
+}
+
+static int getTileTexels(const int size, const int tile)
+{
+	const int left = size - tile * TILE_SIZE;
+	return left < TILE_SIZE ? left : TILE_SIZE;
+}
+
+static GLuint fetchTile(struct TileCache* cache, const struct Pyramid* pyramid, const int level, const int x,
+                        const int y, int* uploads)
+{
+	struct TileSlot* victim = NULL;
+	for (int i = 0; i < cache->slotCount; ++i)
+	{
+		struct TileSlot* slot = &cache->slots[i];
+		if (slot->level == level && slot->x == x && slot->y == y)
+		{
+			slot->lastUsed = cache->frame;
+			return slot->texture;
+		}
+		// Tiles already drawn this frame stay put, so a pool smaller than the screen degrades instead of thrashing
+		if (slot->lastUsed != cache->frame && (!victim || slot->lastUsed < victim->lastUsed)) victim = slot;
+	}
+	if (!victim || *uploads >= TILE_UPLOADS_PER_FRAME) return 0;
+
+	const enum PixelFormat format = pyramid->info.format;
+	const struct TextureFormat* tf = &textureFormats[format];
+	if (!victim->texture)
+	{
+		victim->texture = createTexture();
+		glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, tf->swizzle);
+		glTexImage2D(GL_TEXTURE_2D, 0, tf->internalFormat, TILE_SIZE, TILE_SIZE, 0, tf->format, tf->type, NULL);
+	}
+
+	const struct PyramidLevel* l = &pyramid->levels[level];
+	const size_t pixelSize = getPixelFormatSize(format);
+	const unsigned char* src = l->pixels + (size_t)y * TILE_SIZE * l->stride + (size_t)x * TILE_SIZE * pixelSize;
+
+	glBindTexture(GL_TEXTURE_2D, victim->texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, (GLint)(l->stride / pixelSize));
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, getTileTexels(l->width, x), getTileTexels(l->height, y), tf->format,
+	                tf->type, src);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+	victim->level = level;
+	victim->x = x;
+	victim->y = y;
+	victim->lastUsed = cache->frame;
+	(*uploads)++;
+
+	return victim->texture;
+}
+
+// Draws the tiles of `level` that intersect the view and returns how many of them could not be drawn yet
+static int drawLevel(struct TileCache* cache, const struct Pyramid* pyramid, const struct View* view, const int level,
+                     int* uploads)
+{
+	const struct PyramidLevel* l = &pyramid->levels[level];
+	const double scale = (double)(1 << level), span = TILE_SIZE * scale;
+	const double halfW = view->viewWidth * 0.5 / view->zoom, halfH = view->viewHeight * 0.5 / view->zoom;
+
+	int x0 = (int)floor((view->centerX - halfW) / span), x1 = (int)floor((view->centerX + halfW) / span);
+	int y0 = (int)floor((view->centerY - halfH) / span), y1 = (int)floor((view->centerY + halfH) / span);
+	if (x0 < 0) x0 = 0;
+	if (y0 < 0) y0 = 0;
+	if (x1 >= l->tilesX) x1 = l->tilesX - 1;
+	if (y1 >= l->tilesY) y1 = l->tilesY - 1;
+
+	int missing = 0;
+	for (int y = y0; y <= y1; ++y)
+		for (int x = x0; x <= x1; ++x)
+		{
+			const GLuint texture = fetchTile(cache, pyramid, level, x, y, uploads);
+			if (!texture)
+			{
+				missing++;
+				continue;
+			}
+
+			// Odd sizes round up on every level, so clip the last tile to the real image edge
+			const int texelsW = getTileTexels(l->width, x), texelsH = getTileTexels(l->height, y);
+			const double left = x * span, top = y * span;
+			const double w = fmin(texelsW * scale, pyramid->info.width - left);
+			const double h = fmin(texelsH * scale, pyramid->info.height - top);
+
+			glBindTexture(GL_TEXTURE_2D, texture);
+			glUniform4f(cache->uTile, (float)left, (float)top, (float)w, (float)h);
+			glUniform2f(cache->uTileSize, (float)(w / scale), (float)(h / scale));
+			glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+		}
+
+	return missing;
+}
+
+int renderTiles(const struct GLObjects* glObjects, const struct Pyramid* pyramid, const struct View* view)
+{
+	if (!glObjects || !glObjects->tiles || !pyramid || !pyramid->levelCount || !view) return 0;
+
+	struct TileCache* cache = glObjects->tiles;
+	cache->frame++;
+
+	// The first level with at most one texel per screen pixel
+	int level = view->zoom < 1.0 ? (int)floor(log2(1.0 / view->zoom)) : 0;
+	if (level >= pyramid->levelCount) level = pyramid->levelCount - 1;
+	const int top = pyramid->levelCount - 1;
+
+	glUseProgram(glObjects->program);
+	glBindVertexArray(glObjects->VAO);
+	glActiveTexture(GL_TEXTURE0);
+	glUniform3f(cache->uCamera, (float)view->centerX, (float)view->centerY, (float)view->zoom);
+
+	// The coarsest level is a single tile that stays resident and fills in wherever a finer tile is still missing
+	int uploads = 0;
+	int missing = drawLevel(cache, pyramid, view, top, &uploads);
+	if (level != top) missing += drawLevel(cache, pyramid, view, level, &uploads);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glBindVertexArray(0);
+	glUseProgram(0);
+
+	return missing;
+}
+
 void destroyObjects(struct GLObjects* glObjects)
 {
+	destroyUploadRing(glObjects);
+	if (glObjects->tiles)
+	{
+		for (int i = 0; i < glObjects->tiles->slotCount; ++i)
+			if (glObjects->tiles->slots[i].texture) glDeleteTextures(1, &glObjects->tiles->slots[i].texture);
+		free(glObjects->tiles);
+		glObjects->tiles = NULL;
+	}
+	if (glObjects->texture)
+	{
+		glDeleteTextures(1, &glObjects->texture);
+		glObjects->texture = 0;
+	}
+	if (glObjects->palette)
+	{
+		glDeleteTextures(1, &glObjects->palette);
+		glObjects->palette = 0;
+	}
+	if (glObjects->PBO)
+	{
+		glDeleteBuffers(1, &glObjects->PBO);
+		glObjects->PBO = 0;
+	}
 	if (glObjects->VBO)
 	{
 		glDeleteBuffers(1, &glObjects->VBO);
@@ -239,8 +855,24 @@ void render(const struct GLObjects* glObjects, const GLsizei totalCount)
 	glUseProgram(glObjects->program);
 	glBindVertexArray(glObjects->VAO);
 
-	glEnable(GL_PROGRAM_POINT_SIZE);
-	glDrawArrays(GL_POINTS, 0, totalCount);
+	if (glObjects->texture)
+	{
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, glObjects->texture);
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_2D, glObjects->palette);
+
+		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+	else
+	{
+		glEnable(GL_PROGRAM_POINT_SIZE);
+		glDrawArrays(GL_POINTS, 0, totalCount);
+	}
 
 	glBindVertexArray(0);
 	glUseProgram(0);
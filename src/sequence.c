@@ -0,0 +1,381 @@
+#include <ctype.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "./include/sequence.h"
+#include "./include/cache.h"
+#include "./include/platform.h"
+
+enum EntryState
+{
+	ENTRY_EMPTY = 0,
+	ENTRY_DECODING,
+	ENTRY_READY,
+	ENTRY_FAILED,
+	ENTRY_DEFERRED // did not fit the budget; retried once the cursor moves
+};
+
+struct SequenceEntry
+{
+	char* path;
+	enum EntryState state;
+	const struct CachedImage* image;
+	int pins, cancelled; // `cancelled` is only touched by the thread decoding the entry
+	atomic_int cancel;
+};
+
+struct Sequence
+{
+	pthread_mutex_t lock;
+	pthread_cond_t work;
+	struct SequenceEntry* entries;
+	char** paths;
+	int count, cursor, ahead, behind, stop, threadCount;
+	size_t budget, used;
+	struct ImageCache* cache;
+	SequenceWake wake;
+	pthread_t threads[SEQUENCE_MAX_THREADS];
+};
+
+static int isImagePath(const char* path)
+{
+	static const char* extensions[] = {"ppm", "pgm", "pbm", "pnm", "png"};
+
+	const char* dot = strrchr(path, '.');
+	if (!dot || strlen(dot + 1) != 3) return 0;
+
+	char ext[4];
+	for (int i = 0; i < 4; ++i) ext[i] = (char)tolower((unsigned char)dot[1 + i]);
+	for (size_t i = 0; i < sizeof(extensions) / sizeof(extensions[0]); ++i)
+		if (strcmp(ext, extensions[i]) == 0) return 1;
+
+	return 0;
+}
+
+static int comparePaths(const void* a, const void* b)
+{
+	return strcmp(*(const char* const*)a, *(const char* const*)b);
+}
+
+static int getDistance(const struct Sequence* s, const int index)
+{
+	return index > s->cursor ? index - s->cursor : s->cursor - index;
+}
+
+static int isInWindow(const struct Sequence* s, const int index)
+{
+	return index >= s->cursor - s->behind && index <= s->cursor + s->ahead;
+}
+
+// The cursor first, then alternating ahead and behind, nearest first; called with the lock held
+static int pickEntry(const struct Sequence* s)
+{
+	const int reach = s->ahead > s->behind ? s->ahead : s->behind;
+	for (int d = 0; d <= reach; ++d)
+	{
+		const int candidates[2] = {s->cursor + d, s->cursor - d};
+		for (int k = 0; k < (d ? 2 : 1); ++k)
+		{
+			const int i = candidates[k];
+			if (d > (k ? s->behind : s->ahead) || i < 0 || i >= s->count) continue;
+			if (s->entries[i].state == ENTRY_EMPTY) return i;
+		}
+	}
+
+	return -1;
+}
+
+// Hands the image back to the cache, which keeps it for a revisit while its budget allows; called with the lock held
+static void dropEntry(struct Sequence* s, struct SequenceEntry* e)
+{
+	s->used -= e->image->info.size;
+	releaseImage(s->cache, e->image);
+	e->image = NULL;
+	e->state = ENTRY_EMPTY;
+}
+
+// Makes room for `bytes` by evicting images outside the window, or farther from the cursor than `index`. The
+// cursor's own image is admitted even when nothing is left to evict. Called with the lock held.
+static int reserveBytes(struct Sequence* s, const int index, const size_t bytes)
+{
+	while (s->used + bytes > s->budget)
+	{
+		int victim = -1;
+		for (int i = 0; i < s->count; ++i)
+		{
+			const struct SequenceEntry* e = &s->entries[i];
+			if (e->state != ENTRY_READY || e->pins || i == s->cursor) continue;
+			if (isInWindow(s, i) && getDistance(s, i) <= getDistance(s, index)) continue;
+			if (victim < 0 || getDistance(s, i) > getDistance(s, victim)) victim = i;
+		}
+		if (victim < 0) break;
+
+		dropEntry(s, &s->entries[victim]);
+	}
+
+	if (s->used + bytes > s->budget && index != s->cursor) return 0;
+
+	s->used += bytes;
+	return 1;
+}
+
+static void beginRows(void* user)
+{
+	(void)user;
+}
+
+static int endRows(void* user, const int y, const int count)
+{
+	(void)y;
+	(void)count;
+	struct SequenceEntry* e = user;
+	if (atomic_load(&e->cancel)) e->cancelled = 1;
+
+	return !e->cancelled;
+}
+
+// Decodes one entry with the lock released and returns its new state, with the lock held again
+static enum EntryState decodeEntry(struct Sequence* s, const int index)
+{
+	struct SequenceEntry* e = &s->entries[index];
+	pthread_mutex_unlock(&s->lock);
+
+	struct MappedFile file;
+	struct ImageInfo info;
+	if (!mapFile(e->path, &file))
+	{
+		fprintf(stderr, "Failed to read file: %s\n", e->path);
+		pthread_mutex_lock(&s->lock);
+
+		return ENTRY_FAILED;
+	}
+
+	const unsigned char* data = file.data;
+	// Prefetched images live in memory, so out-of-core ones are refused like any other image that cannot be shown
+	if (!getImageInfo(data, file.size, PIXEL_FORMAT_NATIVE, &info) || info.format == PIXEL_FORMAT_POINT ||
+		info.outOfCore)
+	{
+		fprintf(stderr, "Failed to parse image: %s\n", e->path);
+		unmapFile(&file);
+		pthread_mutex_lock(&s->lock);
+
+		return ENTRY_FAILED;
+	}
+
+	pthread_mutex_lock(&s->lock);
+	const int reserved = reserveBytes(s, index, info.size);
+	pthread_mutex_unlock(&s->lock);
+	if (!reserved)
+	{
+		unmapFile(&file);
+		pthread_mutex_lock(&s->lock);
+
+		return ENTRY_DEFERRED;
+	}
+
+	e->cancelled = 0;
+	const struct RowSink sink = {beginRows, endRows, e};
+	const struct CachedImage* image = acquireImage(s->cache, data, file.size, PIXEL_FORMAT_NATIVE, &sink);
+	unmapFile(&file);
+
+	pthread_mutex_lock(&s->lock);
+	if (!image)
+	{
+		s->used -= info.size;
+		if (e->cancelled) return ENTRY_EMPTY;
+
+		fprintf(stderr, "Failed to parse image: %s\n", e->path);
+		return ENTRY_FAILED;
+	}
+
+	e->image = image;
+	return ENTRY_READY;
+}
+
+static void* sequenceThread(void* arg)
+{
+	struct Sequence* s = arg;
+
+	pthread_mutex_lock(&s->lock);
+	while (!s->stop)
+	{
+		const int index = pickEntry(s);
+		if (index < 0)
+		{
+			pthread_cond_wait(&s->work, &s->lock);
+			continue;
+		}
+
+		struct SequenceEntry* e = &s->entries[index];
+		e->state = ENTRY_DECODING;
+		atomic_store(&e->cancel, 0);
+
+		e->state = decodeEntry(s, index);
+		if (e->state == ENTRY_READY || e->state == ENTRY_FAILED)
+		{
+			pthread_mutex_unlock(&s->lock);
+			if (s->wake) s->wake();
+			pthread_mutex_lock(&s->lock);
+		}
+	}
+	pthread_mutex_unlock(&s->lock);
+
+	return NULL;
+}
+
+struct Sequence* openSequence(const char* pattern, const int ahead, const int behind, const size_t budget,
+                              struct ImageCache* cache, const SequenceWake wake)
+{
+	char** paths;
+	int count;
+	if (!listFiles(pattern, &paths, &count))
+	{
+		fprintf(stderr, "Failed to list images: %s\n", pattern);
+		return NULL;
+	}
+
+	// A directory lists everything in it; a glob already says which files are wanted
+	if (isDirectory(pattern))
+	{
+		int kept = 0;
+		for (int i = 0; i < count; ++i)
+		{
+			if (isImagePath(paths[i])) paths[kept++] = paths[i];
+			else free(paths[i]);
+		}
+		count = kept;
+	}
+	if (!count)
+	{
+		fprintf(stderr, "No images found: %s\n", pattern);
+		freeFileList(paths, count);
+
+		return NULL;
+	}
+	qsort(paths, (size_t)count, sizeof(char*), comparePaths);
+
+	struct Sequence* s = calloc(1, sizeof(*s));
+	struct SequenceEntry* entries = calloc((size_t)count, sizeof(*entries));
+	if (!s || !entries)
+	{
+		fprintf(stderr, "Failed to allocate image sequence\n");
+		freeFileList(paths, count);
+		free(entries);
+		free(s);
+
+		return NULL;
+	}
+
+	s->entries = entries;
+	s->paths = paths;
+	s->count = count;
+	s->ahead = ahead > 0 ? ahead : 0;
+	s->behind = behind > 0 ? behind : 0;
+	s->budget = budget;
+	s->cache = cache;
+	s->wake = wake;
+	for (int i = 0; i < count; ++i)
+	{
+		entries[i].path = paths[i];
+		atomic_init(&entries[i].cancel, 0);
+	}
+	pthread_mutex_init(&s->lock, NULL);
+	pthread_cond_init(&s->work, NULL);
+
+	// One core stays with the render thread
+	int threads = getProcessorCount() - 1;
+	if (threads < 1) threads = 1;
+	if (threads > SEQUENCE_MAX_THREADS) threads = SEQUENCE_MAX_THREADS;
+	for (int i = 0; i < threads; ++i)
+		if (pthread_create(&s->threads[s->threadCount], NULL, sequenceThread, s) == 0) s->threadCount++;
+
+	if (!s->threadCount)
+	{
+		fprintf(stderr, "Failed to start decoder threads\n");
+		closeSequence(s);
+
+		return NULL;
+	}
+	return s;
+}
+
+void closeSequence(struct Sequence* sequence)
+{
+	if (!sequence) return;
+
+	pthread_mutex_lock(&sequence->lock);
+	sequence->stop = 1;
+	for (int i = 0; i < sequence->count; ++i) atomic_store(&sequence->entries[i].cancel, 1);
+	pthread_cond_broadcast(&sequence->work);
+	pthread_mutex_unlock(&sequence->lock);
+
+	for (int i = 0; i < sequence->threadCount; ++i) pthread_join(sequence->threads[i], NULL);
+
+	for (int i = 0; i < sequence->count; ++i) releaseImage(sequence->cache, sequence->entries[i].image);
+	freeFileList(sequence->paths, sequence->count);
+	free(sequence->entries);
+	pthread_cond_destroy(&sequence->work);
+	pthread_mutex_destroy(&sequence->lock);
+	free(sequence);
+}
+
+int getSequenceLength(const struct Sequence* sequence)
+{
+	return sequence ? sequence->count : 0;
+}
+
+const char* getSequencePath(const struct Sequence* sequence, const int index)
+{
+	return sequence && index >= 0 && index < sequence->count ? sequence->paths[index] : NULL;
+}
+
+void setSequenceCursor(struct Sequence* sequence, int index)
+{
+	if (index < 0) index = 0;
+	if (index >= sequence->count) index = sequence->count - 1;
+
+	pthread_mutex_lock(&sequence->lock);
+	sequence->cursor = index;
+	for (int i = 0; i < sequence->count; ++i)
+	{
+		struct SequenceEntry* e = &sequence->entries[i];
+		if (e->state == ENTRY_DECODING) atomic_store(&e->cancel, !isInWindow(sequence, i));
+		else if (e->state == ENTRY_DEFERRED) e->state = ENTRY_EMPTY;
+		else if (e->state == ENTRY_READY && !e->pins && !isInWindow(sequence, i)) dropEntry(sequence, e);
+	}
+	pthread_cond_broadcast(&sequence->work);
+	pthread_mutex_unlock(&sequence->lock);
+}
+
+int lockSequenceImage(struct Sequence* sequence, const int index, struct ImageInfo* info, const void** pixels)
+{
+	if (!sequence || index < 0 || index >= sequence->count) return -1;
+
+	pthread_mutex_lock(&sequence->lock);
+	struct SequenceEntry* e = &sequence->entries[index];
+	int result = 0;
+	if (e->state == ENTRY_READY)
+	{
+		e->pins++;
+		*info = e->image->info;
+		*pixels = e->image->pixels;
+		result = 1;
+	}
+	else if (e->state == ENTRY_FAILED) result = -1;
+	pthread_mutex_unlock(&sequence->lock);
+
+	return result;
+}
+
+void unlockSequenceImage(struct Sequence* sequence, const int index)
+{
+	if (!sequence || index < 0 || index >= sequence->count) return;
+
+	pthread_mutex_lock(&sequence->lock);
+	struct SequenceEntry* e = &sequence->entries[index];
+	if (!--e->pins && e->state == ENTRY_READY && !isInWindow(sequence, index)) dropEntry(sequence, e);
+	pthread_mutex_unlock(&sequence->lock);
+}
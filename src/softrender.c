@@ -0,0 +1,369 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SOFTRENDER_SSE2 1
+#endif
+
+#include "./include/softrender.h"
+#include "./include/platform.h"
+
+#define SOFT_MAX_THREADS 64
+#define SOFT_MIN_BAND_ROWS 16
+
+struct SoftBand
+{
+	struct SoftObjects* objects;
+	unsigned char* scratch;
+	int y0, y1;
+};
+
+static unsigned char floatToByte(const float v)
+{
+	return v <= 0.0f ? 0 : v >= 1.0f ? 255 : (unsigned char)(v * 255.0f + 0.5f);
+}
+
+// Rounds like the GL does when a normalized 16-bit sample lands in an 8-bit framebuffer
+static unsigned char shortToByte(const unsigned int v)
+{
+	return (unsigned char)((v + 128) / 257);
+}
+
+static unsigned char blendChannel(const unsigned int s, const unsigned int d, const unsigned int a)
+{
+	const unsigned int t = s * a + d * (255 - a) + 128;
+	return (unsigned char)((t + (t >> 8)) >> 8);
+}
+
+// Expands `width` source pixels to RGBA8, applying the same swizzles as the GL texture formats
+static void fetchRow(const struct ImageInfo* info, const unsigned char* src, unsigned char* dst, const int width)
+{
+	const uint16_t* src16 = (const uint16_t*)src;
+	const float* srcf = (const float*)src;
+	switch (info->format)
+	{
+		case PIXEL_FORMAT_RGB8:
+			for (int x = 0; x < width; ++x, dst += 4, src += 3)
+			{
+				dst[0] = src[0];
+				dst[1] = src[1];
+				dst[2] = src[2];
+				dst[3] = 255;
+			}
+			break;
+		case PIXEL_FORMAT_RGBA8:
+			memcpy(dst, src, (size_t)width * 4);
+			break;
+		case PIXEL_FORMAT_RGBA32F:
+			for (int x = 0; x < width * 4; ++x) dst[x] = floatToByte(srcf[x]);
+			break;
+		case PIXEL_FORMAT_INDEX8:
+			for (int x = 0; x < width; ++x) memcpy(dst + 4 * (size_t)x, info->palette[src[x]], 4);
+			break;
+		case PIXEL_FORMAT_GRAY8:
+			for (int x = 0; x < width; ++x, dst += 4)
+			{
+				dst[0] = dst[1] = dst[2] = src[x];
+				dst[3] = 255;
+			}
+			break;
+		case PIXEL_FORMAT_GRAY16:
+			for (int x = 0; x < width; ++x, dst += 4)
+			{
+				dst[0] = dst[1] = dst[2] = shortToByte(src16[x]);
+				dst[3] = 255;
+			}
+			break;
+		case PIXEL_FORMAT_RGB16:
+			for (int x = 0; x < width; ++x, dst += 4, src16 += 3)
+			{
+				dst[0] = shortToByte(src16[0]);
+				dst[1] = shortToByte(src16[1]);
+				dst[2] = shortToByte(src16[2]);
+				dst[3] = 255;
+			}
+			break;
+		case PIXEL_FORMAT_RGBA16:
+			for (int x = 0; x < width * 4; ++x) dst[x] = shortToByte(src16[x]);
+			break;
+		default:
+			break;
+	}
+}
+
+#ifdef SOFTRENDER_SSE2
+// Two RGBA pixels widened to 16-bit lanes: (s * a + d * (255 - a)) / 255, rounded exactly
+static __m128i blendPixels(const __m128i s, const __m128i d)
+{
+	const __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, 0xFF), 0xFF);
+	const __m128i t = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(s, a),
+	                                              _mm_mullo_epi16(d, _mm_sub_epi16(_mm_set1_epi16(255), a))),
+	                                _mm_set1_epi16(128));
+
+	return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+#endif
+
+// SRC_ALPHA, ONE_MINUS_SRC_ALPHA over the framebuffer, four pixels per step; fully opaque or fully transparent
+// groups skip the arithmetic
+static void blendRow(unsigned char* dst, const unsigned char* src, const int width)
+{
+	int x = 0;
+#ifdef SOFTRENDER_SSE2
+	const __m128i zero = _mm_setzero_si128(), alphaMask = _mm_set1_epi32((int)0xFF000000u);
+	for (; x + 4 <= width; x += 4)
+	{
+		const __m128i s = _mm_loadu_si128((const __m128i*)(src + 4 * (size_t)x));
+		const __m128i alpha = _mm_and_si128(s, alphaMask);
+		if (_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, alphaMask)) == 0xFFFF)
+		{
+			_mm_storeu_si128((__m128i*)(dst + 4 * (size_t)x), s);
+			continue;
+		}
+		if (_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, zero)) == 0xFFFF) continue;
+
+		const __m128i d = _mm_loadu_si128((const __m128i*)(dst + 4 * (size_t)x));
+		const __m128i lo = blendPixels(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero));
+		const __m128i hi = blendPixels(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero));
+		_mm_storeu_si128((__m128i*)(dst + 4 * (size_t)x), _mm_packus_epi16(lo, hi));
+	}
+#endif
+	for (; x < width; ++x)
+	{
+		const unsigned char* s = src + 4 * (size_t)x;
+		unsigned char* d = dst + 4 * (size_t)x;
+		for (int c = 0; c < 4; ++c) d[c] = blendChannel(s[c], d[c], s[3]);
+	}
+}
+
+static void clearRows(const struct SoftObjects* objects, const int y0, const int y1)
+{
+	unsigned char* row = objects->frame + (size_t)y0 * objects->width * 4;
+	for (int x = 0; x < objects->width; ++x) memcpy(row + 4 * (size_t)x, objects->clear, 4);
+	for (int y = y0 + 1; y < y1; ++y)
+		memcpy(objects->frame + (size_t)y * objects->width * 4, row, (size_t)objects->width * 4);
+}
+
+static void drawImageRows(const struct SoftObjects* objects, unsigned char* scratch, const int y0, const int y1)
+{
+	const struct ImageInfo* info = &objects->info;
+	const int span = info->width * PIXEL_SIZE < objects->width - PADDING ? info->width * PIXEL_SIZE
+	                                                                       : objects->width - PADDING;
+	if (span <= 0) return;
+	const int columns = (span + PIXEL_SIZE - 1) / PIXEL_SIZE;
+
+	for (int y = y0 > PADDING ? y0 : PADDING; y < y1; ++y)
+	{
+		const int iy = (y - PADDING) / PIXEL_SIZE;
+		if (iy >= info->height) break;
+
+		const unsigned char* src = (const unsigned char*)objects->pixels + (size_t)iy * info->stride;
+		unsigned char* dst = objects->frame + ((size_t)y * objects->width + PADDING) * 4;
+
+		// Opaque rows are written straight into the framebuffer
+		if (objects->opaque && PIXEL_SIZE == 1)
+		{
+			fetchRow(info, src, dst, columns);
+			continue;
+		}
+
+		fetchRow(info, src, scratch, columns);
+		if (PIXEL_SIZE > 1)
+			for (int x = span - 1; x >= 0; --x)
+				memmove(scratch + 4 * (size_t)x, scratch + 4 * (size_t)(x / PIXEL_SIZE), 4);
+		if (objects->opaque) memcpy(dst, scratch, (size_t)span * 4);
+		else blendRow(dst, scratch, span);
+	}
+}
+
+static void drawPoints(const struct SoftObjects* objects, const int y0, const int y1)
+{
+	for (size_t i = 0; i < objects->pointCount; ++i)
+	{
+		const struct Pixel* p = &objects->points[i];
+		const int size = (int)p->size;
+		const int left = PADDING + (int)p->x * size, top = PADDING + (int)p->y * size;
+		if (size <= 0 || top >= y1 || top + size <= y0 || left >= objects->width || left + size <= 0) continue;
+
+		const unsigned char color[4] = {floatToByte(p->r), floatToByte(p->g), floatToByte(p->b), floatToByte(p->a)};
+		const int ys = top > y0 ? top : y0, ye = top + size < y1 ? top + size : y1;
+		const int xs = left > 0 ? left : 0, xe = left + size < objects->width ? left + size : objects->width;
+		for (int y = ys; y < ye; ++y)
+			for (int x = xs; x < xe; ++x)
+			{
+				unsigned char* d = objects->frame + ((size_t)y * objects->width + x) * 4;
+				for (int c = 0; c < 4; ++c) d[c] = blendChannel(color[c], d[c], color[3]);
+			}
+	}
+}
+
+static void* renderBand(void* arg)
+{
+	const struct SoftBand* band = arg;
+	const struct SoftObjects* objects = band->objects;
+
+	clearRows(objects, band->y0, band->y1);
+	if (objects->pixels) drawImageRows(objects, band->scratch, band->y0, band->y1);
+	else drawPoints(objects, band->y0, band->y1);
+
+	return NULL;
+}
+
+static void initSoftObjects(struct SoftObjects* out)
+{
+	memset(out, 0, sizeof(*out));
+	out->threadCount = getProcessorCount();
+	if (out->threadCount > SOFT_MAX_THREADS) out->threadCount = SOFT_MAX_THREADS;
+	out->clear[3] = 255;
+}
+
+int createSoftObjects(struct SoftObjects* out, const struct Pixel* pixelObjects, const size_t totalCount)
+{
+	if (!out || (!pixelObjects && totalCount)) return 0;
+
+	initSoftObjects(out);
+	out->points = pixelObjects;
+	out->pointCount = totalCount;
+
+	return 1;
+}
+
+int createSoftTextureObjects(struct SoftObjects* out, const struct ImageInfo* info, const void* pixels)
+{
+	if (!out || !info || !pixels || info->format <= PIXEL_FORMAT_POINT || info->format >= PIXEL_FORMAT_COUNT)
+	{
+		fprintf(stderr, "Unsupported software pixel format: %d\n", info ? (int)info->format : -1);
+		return 0;
+	}
+
+	initSoftObjects(out);
+	out->info = *info;
+	out->pixels = pixels;
+
+	switch (info->format)
+	{
+		case PIXEL_FORMAT_RGB8:
+		case PIXEL_FORMAT_GRAY8:
+		case PIXEL_FORMAT_GRAY16:
+		case PIXEL_FORMAT_RGB16:
+			out->opaque = 1;
+			break;
+		case PIXEL_FORMAT_INDEX8:
+			out->opaque = 1;
+			for (int i = 0; i < 256; ++i)
+				if (info->palette[i][3] != 255) out->opaque = 0;
+			break;
+		default:
+			break;
+	}
+
+	return 1;
+}
+
+int updateSoftPositions(struct SoftObjects* softObjects, const int fbW, const int fbH)
+{
+	if (!softObjects || fbW <= 0 || fbH <= 0) return 0;
+	if (softObjects->frame && softObjects->width == fbW && softObjects->height == fbH) return 1;
+
+	free(softObjects->frame);
+	free(softObjects->scratch);
+	softObjects->frame = malloc((size_t)fbW * fbH * 4);
+	softObjects->scratch = malloc((size_t)fbW * 4 * softObjects->threadCount);
+	if (!softObjects->frame || !softObjects->scratch)
+	{
+		fprintf(stderr, "Failed to allocate %dx%d software framebuffer\n", fbW, fbH);
+		free(softObjects->frame);
+		free(softObjects->scratch);
+		softObjects->frame = softObjects->scratch = NULL;
+		softObjects->width = softObjects->height = 0;
+
+		return 0;
+	}
+
+	softObjects->width = fbW;
+	softObjects->height = fbH;
+	return 1;
+}
+
+void setSoftClearColor(struct SoftObjects* softObjects, const float r, const float g, const float b, const float a)
+{
+	softObjects->clear[0] = floatToByte(r);
+	softObjects->clear[1] = floatToByte(g);
+	softObjects->clear[2] = floatToByte(b);
+	softObjects->clear[3] = floatToByte(a);
+}
+
+void destroySoftObjects(struct SoftObjects* softObjects)
+{
+	if (!softObjects) return;
+
+	free(softObjects->frame);
+	free(softObjects->scratch);
+	memset(softObjects, 0, sizeof(*softObjects));
+}
+
+// Splits the framebuffer into one band of scanlines per thread; the calling thread renders the first band itself
+int renderSoft(struct SoftObjects* softObjects)
+{
+	if (!softObjects || !softObjects->frame) return 0;
+
+	int bands = softObjects->height / SOFT_MIN_BAND_ROWS;
+	if (bands > softObjects->threadCount) bands = softObjects->threadCount;
+	if (bands < 1) bands = 1;
+
+	struct SoftBand jobs[SOFT_MAX_THREADS];
+	pthread_t threads[SOFT_MAX_THREADS];
+	int started[SOFT_MAX_THREADS] = {0};
+
+	for (int i = 0; i < bands; ++i)
+	{
+		jobs[i].objects = softObjects;
+		jobs[i].scratch = softObjects->scratch + (size_t)i * softObjects->width * 4;
+		jobs[i].y0 = (int)((long long)softObjects->height * i / bands);
+		jobs[i].y1 = (int)((long long)softObjects->height * (i + 1) / bands);
+	}
+	for (int i = 1; i < bands; ++i) started[i] = pthread_create(&threads[i], NULL, renderBand, &jobs[i]) == 0;
+
+	renderBand(&jobs[0]);
+	for (int i = 1; i < bands; ++i)
+	{
+		if (started[i]) pthread_join(threads[i], NULL);
+		else renderBand(&jobs[i]);
+	}
+
+	return 1;
+}
+
+int writeSoftFramePPM(const struct SoftObjects* softObjects, const char* path)
+{
+	if (!softObjects || !softObjects->frame || !path) return 0;
+
+	FILE* file = fopen(path, "wb");
+	unsigned char* row = malloc((size_t)softObjects->width * 3);
+	if (!file || !row)
+	{
+		fprintf(stderr, "Failed to write frame: %s\n", path);
+		if (file) fclose(file);
+		free(row);
+
+		return 0;
+	}
+
+	int ok = fprintf(file, "P6\n%d %d\n255\n", softObjects->width, softObjects->height) > 0;
+	for (int y = 0; ok && y < softObjects->height; ++y)
+	{
+		const unsigned char* src = softObjects->frame + (size_t)y * softObjects->width * 4;
+		for (int x = 0; x < softObjects->width; ++x) memcpy(row + 3 * (size_t)x, src + 4 * (size_t)x, 3);
+		ok = fwrite(row, 3, (size_t)softObjects->width, file) == (size_t)softObjects->width;
+	}
+
+	free(row);
+	if (fclose(file) != 0) ok = 0;
+	if (!ok) fprintf(stderr, "Failed to write frame: %s\n", path);
+
+	return ok;
+}
@@ -0,0 +1,105 @@
+#include <string.h>
+
+#include "./include/uploadring.h"
+
+int initUploadRing(struct UploadRing* ring, unsigned char* memory, const unsigned int buffer, const size_t stride,
+                   const int slotRows)
+{
+	if (!ring || !memory || !stride || slotRows <= 0) return 0;
+
+	memset(ring, 0, sizeof(*ring));
+	ring->buffer = buffer;
+	ring->memory = memory;
+	ring->stride = stride;
+	ring->slotRows = slotRows;
+
+	for (int i = 0; i < UPLOAD_RING_SLOTS; ++i)
+	{
+		ring->slots[i].offset = (size_t)i * slotRows * stride;
+		ring->slots[i].data = memory + ring->slots[i].offset;
+	}
+
+	pthread_mutex_init(&ring->lock, NULL);
+	pthread_cond_init(&ring->freed, NULL);
+
+	return 1;
+}
+
+void freeUploadRing(struct UploadRing* ring)
+{
+	if (!ring || !ring->memory) return;
+
+	pthread_cond_destroy(&ring->freed);
+	pthread_mutex_destroy(&ring->lock);
+	ring->memory = NULL;
+}
+
+// True when the consumer has taken everything queued so far and the next slot can be filled without waiting
+int isUploadRingIdle(struct UploadRing* ring)
+{
+	pthread_mutex_lock(&ring->lock);
+
+	int idle = ring->slots[ring->head].state == UPLOAD_SLOT_FREE;
+	for (int i = 0; idle && i < UPLOAD_RING_SLOTS; ++i)
+		if (ring->slots[i].state == UPLOAD_SLOT_READY) idle = 0;
+
+	pthread_mutex_unlock(&ring->lock);
+	return idle;
+}
+
+unsigned char* acquireUploadSlot(struct UploadRing* ring)
+{
+	pthread_mutex_lock(&ring->lock);
+	while (!ring->closed && ring->slots[ring->head].state != UPLOAD_SLOT_FREE)
+		pthread_cond_wait(&ring->freed, &ring->lock);
+
+	unsigned char* data = ring->closed ? NULL : ring->slots[ring->head].data;
+	pthread_mutex_unlock(&ring->lock);
+
+	return data;
+}
+
+void submitUploadSlot(struct UploadRing* ring, const int y, const int count)
+{
+	pthread_mutex_lock(&ring->lock);
+
+	struct UploadSlot* slot = &ring->slots[ring->head];
+	slot->y = y;
+	slot->count = count;
+	slot->state = UPLOAD_SLOT_READY;
+	ring->head = (ring->head + 1) % UPLOAD_RING_SLOTS;
+
+	pthread_mutex_unlock(&ring->lock);
+}
+
+void closeUploadRing(struct UploadRing* ring)
+{
+	pthread_mutex_lock(&ring->lock);
+	ring->closed = 1;
+	pthread_cond_broadcast(&ring->freed);
+	pthread_mutex_unlock(&ring->lock);
+}
+
+struct UploadSlot* takeReadySlot(struct UploadRing* ring)
+{
+	pthread_mutex_lock(&ring->lock);
+
+	struct UploadSlot* slot = &ring->slots[ring->tail];
+	if (slot->state == UPLOAD_SLOT_READY)
+	{
+		slot->state = UPLOAD_SLOT_IN_FLIGHT;
+		ring->tail = (ring->tail + 1) % UPLOAD_RING_SLOTS;
+	}
+	else slot = NULL;
+
+	pthread_mutex_unlock(&ring->lock);
+	return slot;
+}
+
+void releaseUploadSlot(struct UploadRing* ring, struct UploadSlot* slot)
+{
+	pthread_mutex_lock(&ring->lock);
+	slot->state = UPLOAD_SLOT_FREE;
+	pthread_cond_broadcast(&ring->freed);
+	pthread_mutex_unlock(&ring->lock);
+}
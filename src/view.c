@@ -0,0 +1,173 @@
+#include <math.h>
+
+#include "./include/view.h"
+
+#define VIEW_ZOOM_STEP 1.25
+#define VIEW_MAX_ZOOM 64.0
+#define VIEW_PAN_FRACTION 0.1
+
+static double clamp(const double v, const double lo, const double hi)
+{
+	return v < lo ? lo : v > hi ? hi : v;
+}
+
+static void clampView(struct View* view)
+{
+	view->zoom = clamp(view->zoom, view->minZoom, view->maxZoom);
+	view->centerX = clamp(view->centerX, 0.0, view->imageWidth);
+	view->centerY = clamp(view->centerY, 0.0, view->imageHeight);
+}
+
+void fitView(struct View* view)
+{
+	const double fit = fmin((double)view->viewWidth / view->imageWidth, (double)view->viewHeight / view->imageHeight);
+
+	view->minZoom = fmin(fit, 1.0) * 0.5;
+	view->maxZoom = VIEW_MAX_ZOOM;
+	view->zoom = fmin(fit, 1.0);
+	view->centerX = view->imageWidth * 0.5;
+	view->centerY = view->imageHeight * 0.5;
+	view->dirty = 1;
+}
+
+void initView(struct View* view, const int imageWidth, const int imageHeight, const int viewWidth,
+              const int viewHeight)
+{
+	view->imageWidth = imageWidth > 0 ? imageWidth : 1;
+	view->imageHeight = imageHeight > 0 ? imageHeight : 1;
+	view->viewWidth = viewWidth > 0 ? viewWidth : 1;
+	view->viewHeight = viewHeight > 0 ? viewHeight : 1;
+	view->dragging = 0;
+	fitView(view);
+}
+
+void resizeView(struct View* view, const int viewWidth, const int viewHeight)
+{
+	if (viewWidth <= 0 || viewHeight <= 0 || (viewWidth == view->viewWidth && viewHeight == view->viewHeight)) return;
+
+	view->viewWidth = viewWidth;
+	view->viewHeight = viewHeight;
+
+	const double fit = fmin((double)viewWidth / view->imageWidth, (double)viewHeight / view->imageHeight);
+	view->minZoom = fmin(fit, 1.0) * 0.5;
+	clampView(view);
+	view->dirty = 1;
+}
+
+void zoomView(struct View* view, const double factor, const double anchorX, const double anchorY)
+{
+	const double dx = anchorX - view->viewWidth * 0.5, dy = anchorY - view->viewHeight * 0.5;
+	const double imageX = view->centerX + dx / view->zoom, imageY = view->centerY + dy / view->zoom;
+
+	view->zoom = clamp(view->zoom * factor, view->minZoom, view->maxZoom);
+	view->centerX = imageX - dx / view->zoom;
+	view->centerY = imageY - dy / view->zoom;
+	clampView(view);
+	view->dirty = 1;
+}
+
+void panView(struct View* view, const double dx, const double dy)
+{
+	view->centerX -= dx / view->zoom;
+	view->centerY -= dy / view->zoom;
+	clampView(view);
+	view->dirty = 1;
+}
+
+// GLFW reports the cursor in window coordinates, which differ from framebuffer pixels on high-DPI displays
+static void getCursor(GLFWwindow* window, double* x, double* y)
+{
+	int winW, winH, fbW, fbH;
+	glfwGetWindowSize(window, &winW, &winH);
+	glfwGetFramebufferSize(window, &fbW, &fbH);
+	glfwGetCursorPos(window, x, y);
+
+	if (winW > 0) *x *= (double)fbW / winW;
+	if (winH > 0) *y *= (double)fbH / winH;
+}
+
+static void scrollCallback(GLFWwindow* window, const double dx, const double dy)
+{
+	(void)dx;
+	struct View* view = glfwGetWindowUserPointer(window);
+
+	double x, y;
+	getCursor(window, &x, &y);
+	zoomView(view, pow(VIEW_ZOOM_STEP, dy), x, y);
+}
+
+static void mouseButtonCallback(GLFWwindow* window, const int button, const int action, const int mods)
+{
+	(void)mods;
+	struct View* view = glfwGetWindowUserPointer(window);
+	if (button != GLFW_MOUSE_BUTTON_LEFT) return;
+
+	view->dragging = action == GLFW_PRESS;
+	if (view->dragging) getCursor(window, &view->dragX, &view->dragY);
+}
+
+static void cursorPosCallback(GLFWwindow* window, const double px, const double py)
+{
+	(void)px;
+	(void)py;
+	struct View* view = glfwGetWindowUserPointer(window);
+	if (!view->dragging) return;
+
+	double x, y;
+	getCursor(window, &x, &y);
+	panView(view, x - view->dragX, y - view->dragY);
+	view->dragX = x;
+	view->dragY = y;
+}
+
+static void keyCallback(GLFWwindow* window, const int key, const int scancode, const int action, const int mods)
+{
+	(void)scancode;
+	(void)mods;
+	struct View* view = glfwGetWindowUserPointer(window);
+	if (action == GLFW_RELEASE) return;
+
+	const double cx = view->viewWidth * 0.5, cy = view->viewHeight * 0.5;
+	const double stepX = view->viewWidth * VIEW_PAN_FRACTION, stepY = view->viewHeight * VIEW_PAN_FRACTION;
+	switch (key)
+	{
+		case GLFW_KEY_LEFT:
+			panView(view, stepX, 0.0);
+			break;
+		case GLFW_KEY_RIGHT:
+			panView(view, -stepX, 0.0);
+			break;
+		case GLFW_KEY_UP:
+			panView(view, 0.0, stepY);
+			break;
+		case GLFW_KEY_DOWN:
+			panView(view, 0.0, -stepY);
+			break;
+		case GLFW_KEY_EQUAL:
+		case GLFW_KEY_KP_ADD:
+			zoomView(view, VIEW_ZOOM_STEP, cx, cy);
+			break;
+		case GLFW_KEY_MINUS:
+		case GLFW_KEY_KP_SUBTRACT:
+			zoomView(view, 1.0 / VIEW_ZOOM_STEP, cx, cy);
+			break;
+		case GLFW_KEY_1:
+			zoomView(view, 1.0 / view->zoom, cx, cy);
+			break;
+		case GLFW_KEY_0:
+		case GLFW_KEY_HOME:
+			fitView(view);
+			break;
+		default:
+			break;
+	}
+}
+
+void attachViewControls(GLFWwindow* window, struct View* view)
+{
+	glfwSetWindowUserPointer(window, view);
+	glfwSetScrollCallback(window, scrollCallback);
+	glfwSetMouseButtonCallback(window, mouseButtonCallback);
+	glfwSetCursorPosCallback(window, cursorPosCallback);
+	glfwSetKeyCallback(window, keyCallback);
+}
@@ -0,0 +1,425 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define WRITER_SSE2 1
+#endif
+
+#include "./include/writer.h"
+#include "./include/checksum.h"
+#include "./include/deflate.h"
+
+#define WRITER_MAX_THREADS 64
+#define WRITER_MIN_BAND_ROWS 32
+#define WRITER_IDAT_SIZE (1 << 20)
+
+// How a pixel format is laid out in the file: PNG color type and depth, and bytes per pixel in PNG or PNM order
+struct FileLayout
+{
+	int colorType, bitDepth, bytesPerPixel;
+};
+
+static int getFileLayout(const enum PixelFormat format, struct FileLayout* out)
+{
+	switch (format)
+	{
+		case PIXEL_FORMAT_GRAY8:
+			*out = (struct FileLayout){0, 8, 1};
+			return 1;
+		case PIXEL_FORMAT_GRAY16:
+			*out = (struct FileLayout){0, 16, 2};
+			return 1;
+		case PIXEL_FORMAT_RGB8:
+			*out = (struct FileLayout){2, 8, 3};
+			return 1;
+		case PIXEL_FORMAT_RGB16:
+			*out = (struct FileLayout){2, 16, 6};
+			return 1;
+		case PIXEL_FORMAT_INDEX8:
+			*out = (struct FileLayout){3, 8, 1};
+			return 1;
+		case PIXEL_FORMAT_RGBA8:
+			*out = (struct FileLayout){6, 8, 4};
+			return 1;
+		case PIXEL_FORMAT_RGBA16:
+			*out = (struct FileLayout){6, 16, 8};
+			return 1;
+		default:
+			fprintf(stderr, "Unsupported pixel format for writing: %d\n", (int)format);
+			return 0;
+	}
+}
+
+// Both formats store 16-bit samples big-endian
+static void storeBE16(unsigned char* dst, const unsigned short* src, const size_t count)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		dst[2 * i] = (unsigned char)(src[i] >> 8);
+		dst[2 * i + 1] = (unsigned char)src[i];
+	}
+}
+
+// Returns `src` itself when the row is already in PNM order, otherwise packs it into `row`
+static const unsigned char* packPNMRow(const struct ImageInfo* info, const unsigned char* src, unsigned char* row)
+{
+	const size_t w = (size_t)info->width;
+	switch (info->format)
+	{
+		case PIXEL_FORMAT_GRAY8:
+		case PIXEL_FORMAT_RGB8:
+			return src;
+		case PIXEL_FORMAT_GRAY16:
+			storeBE16(row, (const unsigned short*)src, w);
+			return row;
+		case PIXEL_FORMAT_RGB16:
+			storeBE16(row, (const unsigned short*)src, w * 3);
+			return row;
+		case PIXEL_FORMAT_RGBA8:
+			for (size_t x = 0; x < w; ++x) memcpy(row + 3 * x, src + 4 * x, 3);
+			return row;
+		case PIXEL_FORMAT_RGBA16:
+			for (size_t x = 0; x < w; ++x) storeBE16(row + 6 * x, (const unsigned short*)src + 4 * x, 3);
+			return row;
+		default:
+			for (size_t x = 0; x < w; ++x) memcpy(row + 3 * x, info->palette[src[x]], 3);
+			return row;
+	}
+}
+
+int writePNM(const char* path, const struct ImageInfo* info, const void* pixels, const size_t stride)
+{
+	if (!path || !info || !pixels) return 0;
+
+	struct FileLayout layout;
+	if (!getFileLayout(info->format, &layout)) return 0;
+
+	const int gray = layout.colorType == 0, wide = layout.bitDepth == 16;
+	const size_t rowBytes = (size_t)info->width * (gray ? 1 : 3) * (wide ? 2 : 1);
+	FILE* file = fopen(path, "wb");
+	unsigned char* row = malloc(rowBytes);
+	if (!file || !row)
+	{
+		fprintf(stderr, "Failed to write image: %s\n", path);
+		if (file) fclose(file);
+		free(row);
+
+		return 0;
+	}
+
+	int ok = fprintf(file, "%s\n%d %d\n%d\n", gray ? "P5" : "P6", info->width, info->height, wide ? 65535 : 255) > 0;
+	const unsigned char* src = pixels;
+	if (ok && src == packPNMRow(info, src, row) && stride == rowBytes)
+	{
+		// Rows already in file order and packed back to back go out in a single write
+		ok = fwrite(src, rowBytes, (size_t)info->height, file) == (size_t)info->height;
+	}
+	else
+		for (int y = 0; ok && y < info->height; ++y)
+			ok = fwrite(packPNMRow(info, src + (size_t)y * stride, row), 1, rowBytes, file) == rowBytes;
+
+	free(row);
+	if (fclose(file) != 0) ok = 0;
+	if (!ok) fprintf(stderr, "Failed to write image: %s\n", path);
+
+	return ok;
+}
+
+static unsigned char paethPredict(const int a, const int b, const int c)
+{
+	const int pa = abs(b - c), pb = abs(a - c), pc = abs(a + b - 2 * c);
+	if (pa <= pb && pa <= pc) return (unsigned char)a;
+	return (unsigned char)(pb <= pc ? b : c);
+}
+
+#ifdef WRITER_SSE2
+static __m128i absDiff16(const __m128i x)
+{
+	return _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x));
+}
+
+// Paeth on eight 16-bit lanes: the predictor closest to a + b - c, ties going to a, then b
+static __m128i paeth16(const __m128i a, const __m128i b, const __m128i c)
+{
+	const __m128i pa = absDiff16(_mm_sub_epi16(b, c)), pb = absDiff16(_mm_sub_epi16(a, c));
+	const __m128i pc = absDiff16(_mm_add_epi16(_mm_sub_epi16(b, c), _mm_sub_epi16(a, c)));
+	const __m128i notA = _mm_or_si128(_mm_cmpgt_epi16(pa, pb), _mm_cmpgt_epi16(pa, pc));
+	const __m128i notB = _mm_cmpgt_epi16(pb, pc);
+	const __m128i bc = _mm_or_si128(_mm_andnot_si128(notB, b), _mm_and_si128(notB, c));
+
+	return _mm_or_si128(_mm_andnot_si128(notA, a), _mm_and_si128(notA, bc));
+}
+#endif
+
+// Filters one row with `filter` into `out` and returns the sum of its bytes taken as signed magnitudes, the usual
+// estimate of how well a row will compress. Sixteen bytes go per step; only the first pixel and the tail are scalar.
+static uint64_t filterRow(const int filter, const unsigned char* row, const unsigned char* prev, const size_t n,
+                          const size_t bpp, unsigned char* out)
+{
+	uint64_t cost = 0;
+	size_t i = 0;
+	for (; i < bpp && i < n; ++i)
+	{
+		const int b = prev[i];
+		const unsigned char v = (unsigned char)(row[i] - (filter == 2 || filter == 4 ? b : filter == 3 ? b >> 1 : 0));
+		out[i] = v;
+		cost += v < 128 ? v : 256 - v;
+	}
+
+#ifdef WRITER_SSE2
+	const __m128i zero = _mm_setzero_si128(), one = _mm_set1_epi8(1);
+	__m128i sum = zero;
+	for (; i + 16 <= n; i += 16)
+	{
+		const __m128i x = _mm_loadu_si128((const __m128i*)(row + i));
+		const __m128i a = _mm_loadu_si128((const __m128i*)(row + i - bpp));
+		const __m128i b = _mm_loadu_si128((const __m128i*)(prev + i));
+		__m128i predicted;
+		switch (filter)
+		{
+			case 1:
+				predicted = a;
+				break;
+			case 2:
+				predicted = b;
+				break;
+			case 3:
+				// pavgb rounds up; the filter wants floor((a + b) / 2)
+				predicted = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+				break;
+			default:
+			{
+				const __m128i c = _mm_loadu_si128((const __m128i*)(prev + i - bpp));
+				predicted = _mm_packus_epi16(
+					paeth16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero), _mm_unpacklo_epi8(c, zero)),
+					paeth16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero), _mm_unpackhi_epi8(c, zero)));
+				break;
+			}
+		}
+
+		const __m128i v = _mm_sub_epi8(x, predicted);
+		_mm_storeu_si128((__m128i*)(out + i), v);
+		sum = _mm_add_epi64(sum, _mm_sad_epu8(_mm_min_epu8(v, _mm_sub_epi8(zero, v)), zero));
+	}
+	uint64_t lanes[2];
+	_mm_storeu_si128((__m128i*)lanes, sum);
+	cost += lanes[0] + lanes[1];
+#endif
+
+	for (; i < n; ++i)
+	{
+		const int a = row[i - bpp], b = prev[i], c = prev[i - bpp];
+		const int predicted = filter == 1 ? a : filter == 2 ? b : filter == 3 ? (a + b) >> 1 : paethPredict(a, b, c);
+		const unsigned char v = (unsigned char)(row[i] - predicted);
+		out[i] = v;
+		cost += v < 128 ? v : 256 - v;
+	}
+
+	return cost;
+}
+
+static uint64_t getRowCost(const unsigned char* row, const size_t n)
+{
+	uint64_t cost = 0;
+	for (size_t i = 0; i < n; ++i) cost += row[i] < 128 ? row[i] : 256 - row[i];
+	return cost;
+}
+
+struct FilterBand
+{
+	const struct ImageInfo* info;
+	const unsigned char* pixels;
+	size_t stride, rowBytes, bpp;
+	int wide, adaptive, y0, y1, ok;
+	unsigned char* filtered;
+};
+
+static const unsigned char* getPNGRow(const struct FilterBand* band, const int y, unsigned char* scratch)
+{
+	const unsigned char* src = band->pixels + (size_t)y * band->stride;
+	if (!band->wide) return src;
+
+	storeBE16(scratch, (const unsigned short*)src, band->rowBytes / 2);
+	return scratch;
+}
+
+static void* filterBand(void* arg)
+{
+	struct FilterBand* band = arg;
+	const size_t n = band->rowBytes;
+
+	// Room for four candidate rows plus the current and previous rows when 16-bit samples need swapping
+	unsigned char* scratch = malloc(n * 6 + 1);
+	unsigned char* zeros = calloc(n + 1, 1);
+	band->ok = scratch && zeros;
+	if (band->ok)
+	{
+		unsigned char *swapped[2] = {scratch + n * 4, scratch + n * 5};
+		const unsigned char* prev = band->y0 > 0 ? getPNGRow(band, band->y0 - 1, swapped[(band->y0 - 1) & 1]) : zeros;
+		for (int y = band->y0; y < band->y1; ++y)
+		{
+			const unsigned char* row = getPNGRow(band, y, swapped[y & 1]);
+			unsigned char* out = band->filtered + (size_t)y * (n + 1);
+
+			// Palette indices are not magnitudes, so those rows stay unfiltered as the PNG spec recommends
+			int best = 0;
+			uint64_t bestCost = band->adaptive ? getRowCost(row, n) : 0;
+			for (int f = 1; band->adaptive && f <= 4; ++f)
+			{
+				const uint64_t cost = filterRow(f, row, prev, n, band->bpp, scratch + (size_t)(f - 1) * n);
+				if (cost < bestCost)
+				{
+					best = f;
+					bestCost = cost;
+				}
+			}
+
+			out[0] = (unsigned char)best;
+			memcpy(out + 1, best ? scratch + (size_t)(best - 1) * n : row, n);
+			prev = row;
+		}
+	}
+
+	free(zeros);
+	free(scratch);
+	return NULL;
+}
+
+static int writeChunk(FILE* file, const char* type, const unsigned char* data, const size_t length)
+{
+	const unsigned char header[8] = {
+		(unsigned char)(length >> 24), (unsigned char)(length >> 16), (unsigned char)(length >> 8),
+		(unsigned char)length, (unsigned char)type[0], (unsigned char)type[1], (unsigned char)type[2],
+		(unsigned char)type[3]
+	};
+	const unsigned int crc = updateCRC32(updateCRC32(0, header + 4, 4), data, length);
+	const unsigned char trailer[4] = {
+		(unsigned char)(crc >> 24), (unsigned char)(crc >> 16), (unsigned char)(crc >> 8), (unsigned char)crc
+	};
+
+	return fwrite(header, 1, 8, file) == 8 && (!length || fwrite(data, 1, length, file) == length) &&
+		fwrite(trailer, 1, 4, file) == 4;
+}
+
+static int writePNGChunks(FILE* file, const struct ImageInfo* info, const struct FileLayout* layout,
+                          const unsigned char* stream, const size_t streamSize)
+{
+	static const unsigned char signature[8] = {0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A};
+	const unsigned int w = (unsigned int)info->width, h = (unsigned int)info->height;
+	const unsigned char ihdr[13] = {
+		(unsigned char)(w >> 24), (unsigned char)(w >> 16), (unsigned char)(w >> 8), (unsigned char)w,
+		(unsigned char)(h >> 24), (unsigned char)(h >> 16), (unsigned char)(h >> 8), (unsigned char)h,
+		(unsigned char)layout->bitDepth, (unsigned char)layout->colorType, 0, 0, 0
+	};
+
+	int ok = fwrite(signature, 1, 8, file) == 8 && writeChunk(file, "IHDR", ihdr, 13);
+	if (ok && layout->colorType == 3)
+	{
+		unsigned char plte[256 * 3], trns[256];
+		int opaque = info->paletteSize;
+		for (int i = 0; i < info->paletteSize; ++i)
+		{
+			memcpy(plte + 3 * i, info->palette[i], 3);
+			trns[i] = info->palette[i][3];
+		}
+		while (opaque > 0 && trns[opaque - 1] == 255) opaque--;
+
+		ok = writeChunk(file, "PLTE", plte, (size_t)info->paletteSize * 3) &&
+			(!opaque || writeChunk(file, "tRNS", trns, (size_t)opaque));
+	}
+
+	for (size_t at = 0; ok && at < streamSize; at += WRITER_IDAT_SIZE)
+		ok = writeChunk(file, "IDAT", stream + at, streamSize - at < WRITER_IDAT_SIZE ? streamSize - at
+			                                          : WRITER_IDAT_SIZE);
+
+	return ok && writeChunk(file, "IEND", NULL, 0);
+}
+
+int writePNG(const char* path, const struct ImageInfo* info, const void* pixels, const size_t stride, int threads)
+{
+	if (!path || !info || !pixels || info->width <= 0 || info->height <= 0) return 0;
+
+	struct FileLayout layout;
+	if (!getFileLayout(info->format, &layout)) return 0;
+	if (layout.colorType == 3 && (info->paletteSize < 1 || info->paletteSize > 256))
+	{
+		fprintf(stderr, "Palette image without a palette: %d entries\n", info->paletteSize);
+		return 0;
+	}
+
+	const size_t rowBytes = (size_t)info->width * (size_t)layout.bytesPerPixel;
+	if (rowBytes + 1 > SIZE_MAX / (size_t)info->height)
+	{
+		fprintf(stderr, "Image too large to write: %dx%d\n", info->width, info->height);
+		return 0;
+	}
+
+	const size_t filteredSize = (rowBytes + 1) * (size_t)info->height;
+	unsigned char* filtered = malloc(filteredSize);
+	if (!filtered)
+	{
+		fprintf(stderr, "Failed to allocate memory for PNG rows\n");
+		return 0;
+	}
+
+	// Rows only look at the unfiltered row above them, so bands filter independently; the calling thread takes the first
+	int bands = info->height / WRITER_MIN_BAND_ROWS;
+	if (bands > threads) bands = threads;
+	if (bands > WRITER_MAX_THREADS) bands = WRITER_MAX_THREADS;
+	if (bands < 1) bands = 1;
+
+	struct FilterBand jobs[WRITER_MAX_THREADS];
+	pthread_t workers[WRITER_MAX_THREADS];
+	int started[WRITER_MAX_THREADS] = {0};
+	for (int i = 0; i < bands; ++i)
+	{
+		jobs[i] = (struct FilterBand){
+			info, pixels, stride, rowBytes, (size_t)layout.bytesPerPixel, layout.bitDepth == 16, layout.colorType != 3,
+			(int)((long long)info->height * i / bands), (int)((long long)info->height * (i + 1) / bands), 0, filtered
+		};
+	}
+	for (int i = 1; i < bands; ++i) started[i] = pthread_create(&workers[i], NULL, filterBand, &jobs[i]) == 0;
+
+	filterBand(&jobs[0]);
+	int ok = jobs[0].ok;
+	for (int i = 1; i < bands; ++i)
+	{
+		if (started[i]) pthread_join(workers[i], NULL);
+		else filterBand(&jobs[i]);
+		ok &= jobs[i].ok;
+	}
+
+	unsigned char* stream = NULL;
+	size_t streamSize = 0;
+	ok = ok && deflateZlib(filtered, filteredSize, threads, &stream, &streamSize);
+	free(filtered);
+	if (!ok)
+	{
+		fprintf(stderr, "Failed to encode PNG: %s\n", path);
+		return 0;
+	}
+
+	FILE* file = fopen(path, "wb");
+	ok = file && writePNGChunks(file, info, &layout, stream, streamSize);
+	if (file && fclose(file) != 0) ok = 0;
+	if (!ok) fprintf(stderr, "Failed to write image: %s\n", path);
+	free(stream);
+
+	return ok;
+}
+
+int writeImage(const char* path, const struct ImageInfo* info, const void* pixels, const size_t stride,
+               const int threads)
+{
+	if (!path) return 0;
+
+	const size_t len = strlen(path);
+	const char* ext = len >= 4 ? path + len - 4 : "";
+	const int png = ext[0] == '.' && (ext[1] | 32) == 'p' && (ext[2] | 32) == 'n' && (ext[3] | 32) == 'g';
+
+	return png ? writePNG(path, info, pixels, stride, threads) : writePNM(path, info, pixels, stride);
+}